@@ -0,0 +1,158 @@
+#include "allocator.hpp"
+
+#include <new>
+#include <mutex>
+
+namespace donkey{
+
+namespace{
+
+enum{
+	slab_size = 64 * 1024,
+};
+
+struct free_block{
+	free_block* next;
+};
+
+//pools are never destroyed: blocks may outlive their thread and be freed into another pool
+class pool{
+	pool(const pool&) = delete;
+	void operator=(const pool&) = delete;
+private:
+	free_block* _free[size_classes_count];
+	char* _slab;
+	size_t _slab_left;
+public:
+	//signed, because a block can be freed by a different thread than the one that allocated it
+	ptrdiff_t blocks[size_classes_count + 1];
+	ptrdiff_t bytes[size_classes_count + 1];
+
+	pool():
+		_slab(nullptr),
+		_slab_left(0){
+		for(size_t i = 0; i != size_classes_count; ++i){
+			_free[i] = nullptr;
+		}
+		for(size_t i = 0; i != size_classes_count + 1; ++i){
+			blocks[i] = 0;
+			bytes[i] = 0;
+		}
+	}
+
+	void* allocate(size_t cls){
+		++blocks[cls];
+		bytes[cls] += (cls + 1) * allocation_granularity;
+
+		if(free_block* ret = _free[cls]){
+			_free[cls] = ret->next;
+			return ret;
+		}
+
+		size_t sz = (cls + 1) * allocation_granularity;
+		if(_slab_left < sz){
+			//the tail of the old slab goes to the free lists
+			while(_slab_left >= allocation_granularity){
+				size_t c = _slab_left / allocation_granularity - 1;
+				if(c >= size_classes_count){
+					c = size_classes_count - 1;
+				}
+				size_t csz = (c + 1) * allocation_granularity;
+				free_block* b = reinterpret_cast<free_block*>(_slab);
+				b->next = _free[c];
+				_free[c] = b;
+				_slab += csz;
+				_slab_left -= csz;
+			}
+			_slab = static_cast<char*>(::operator new(slab_size));
+			_slab_left = slab_size;
+		}
+
+		void* ret = _slab;
+		_slab += sz;
+		_slab_left -= sz;
+		return ret;
+	}
+
+	void free(void* p, size_t cls){
+		--blocks[cls];
+		bytes[cls] -= (cls + 1) * allocation_granularity;
+
+		free_block* b = static_cast<free_block*>(p);
+		b->next = _free[cls];
+		_free[cls] = b;
+	}
+};
+
+std::mutex& pools_mutex(){
+	static std::mutex* ret = new std::mutex();
+	return *ret;
+}
+
+std::vector<pool*>& pools(){
+	static std::vector<pool*>* ret = new std::vector<pool*>();
+	return *ret;
+}
+
+pool& current_pool(){
+	static thread_local pool* ret = nullptr;
+	if(!ret){
+		ret = new pool();
+		std::lock_guard<std::mutex> lock(pools_mutex());
+		pools().push_back(ret);
+	}
+	return *ret;
+}
+
+size_t size_class(size_t size){
+	return (size + allocation_granularity - 1) / allocation_granularity - 1;
+}
+
+}//anonymous namespace
+
+void* pool_allocate(size_t size){
+	if(size > max_pooled_size){
+		pool& p = current_pool();
+		++p.blocks[size_classes_count];
+		p.bytes[size_classes_count] += size;
+		return ::operator new(size);
+	}
+	return current_pool().allocate(size_class(size));
+}
+
+void pool_free(void* p, size_t size){
+	if(size > max_pooled_size){
+		pool& cp = current_pool();
+		--cp.blocks[size_classes_count];
+		cp.bytes[size_classes_count] -= size;
+		::operator delete(p);
+		return;
+	}
+	current_pool().free(p, size_class(size));
+}
+
+std::vector<allocation_stats> get_allocation_stats(){
+	std::vector<allocation_stats> ret(size_classes_count + 1);
+
+	for(size_t i = 0; i != size_classes_count; ++i){
+		ret[i].block_size = (i + 1) * allocation_granularity;
+	}
+	ret[size_classes_count].block_size = 0;
+
+	std::lock_guard<std::mutex> lock(pools_mutex());
+
+	for(size_t i = 0; i != size_classes_count + 1; ++i){
+		ptrdiff_t blocks = 0;
+		ptrdiff_t bytes = 0;
+		for(pool* p: pools()){
+			blocks += p->blocks[i];
+			bytes += p->bytes[i];
+		}
+		ret[i].blocks_in_use = blocks;
+		ret[i].bytes_in_use = bytes;
+	}
+
+	return ret;
+}
+
+}//donkey
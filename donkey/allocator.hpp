@@ -0,0 +1,30 @@
+#ifndef __allocator_hpp__
+#define __allocator_hpp__
+
+#include <cstddef>
+#include <vector>
+
+namespace donkey{
+
+enum{
+	allocation_granularity = 16,
+	max_pooled_size = 512,
+	size_classes_count = max_pooled_size / allocation_granularity,
+};
+
+struct allocation_stats{
+	size_t block_size; //0 for allocations bigger than max_pooled_size
+	size_t blocks_in_use;
+	size_t bytes_in_use;
+};
+
+//blocks up to max_pooled_size come from per-thread free lists; size must be passed back on free
+void* pool_allocate(size_t size);
+void pool_free(void* p, size_t size);
+
+//summed over all threads; the last entry is for the allocations that bypass the pools
+std::vector<allocation_stats> get_allocation_stats();
+
+}//donkey
+
+#endif /*__allocator_hpp__*/
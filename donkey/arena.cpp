@@ -0,0 +1,73 @@
+#include "arena.hpp"
+
+namespace donkey{
+
+namespace{
+
+const size_t block_size = 16 * 1024;
+const size_t node_alignment = 16;
+
+arena*& current_arena_ptr(){
+	static thread_local arena* ret = nullptr;
+	return ret;
+}
+
+}//namespace
+
+arena::arena():
+	_blocks(nullptr),
+	_top(nullptr),
+	_left(0),
+	_last(nullptr){
+}
+
+arena::~arena(){
+	for(node_header* h = _last; h;){
+		node_header* prev = h->prev;
+		h->destroy(h);
+		h = prev;
+	}
+
+	for(block* b = _blocks; b;){
+		block* prev = b->prev;
+		::operator delete(b);
+		b = prev;
+	}
+}
+
+void* arena::allocate(size_t size){
+	size = (size + node_alignment - 1) / node_alignment * node_alignment;
+
+	if(size > _left){
+		const size_t header = (sizeof(block) + node_alignment - 1) / node_alignment * node_alignment;
+		const size_t sz = size + header > block_size ? size + header : block_size;
+
+		block* b = static_cast<block*>(::operator new(sz));
+		b->prev = _blocks;
+		b->size = sz;
+		_blocks = b;
+
+		_top = reinterpret_cast<char*>(b) + header;
+		_left = sz - header;
+	}
+
+	void* ret = _top;
+	_top += size;
+	_left -= size;
+	return ret;
+}
+
+arena& current_arena(){
+	return *current_arena_ptr();
+}
+
+arena_scope::arena_scope(arena& a):
+	_prev(current_arena_ptr()){
+	current_arena_ptr() = &a;
+}
+
+arena_scope::~arena_scope(){
+	current_arena_ptr() = _prev;
+}
+
+}//donkey
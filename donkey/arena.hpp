@@ -0,0 +1,74 @@
+#ifndef __arena_hpp__
+#define __arena_hpp__
+
+#include <cstddef>
+#include <utility>
+#include <new>
+
+namespace donkey{
+
+//owns the expression nodes of one module; nodes are laid out in creation order and destroyed together
+class arena{
+	arena(const arena&) = delete;
+	void operator=(const arena&) = delete;
+private:
+	struct node_header{
+		node_header* prev;
+		void (*destroy)(node_header*);
+	};
+
+	struct block{
+		block* prev;
+		size_t size;
+	};
+
+	block* _blocks;
+	char* _top;
+	size_t _left;
+	node_header* _last;
+
+	template<class T>
+	static void destroy_node(node_header* h){
+		reinterpret_cast<T*>(h + 1)->~T();
+	}
+
+	void* allocate(size_t size);
+public:
+	arena();
+	~arena();
+
+	template<class T, class... Args>
+	T* create(Args&&... args){
+		node_header* h = static_cast<node_header*>(allocate(sizeof(node_header) + sizeof(T)));
+		T* ret = new(h + 1) T(std::forward<Args>(args)...);
+
+		//linked only after construction, so a throwing constructor leaves nothing to destroy
+		h->prev = _last;
+		h->destroy = &destroy_node<T>;
+		_last = h;
+
+		return ret;
+	}
+};
+
+//arena that receives nodes built on this thread
+arena& current_arena();
+
+class arena_scope{
+	arena_scope(const arena_scope&) = delete;
+	void operator=(const arena_scope&) = delete;
+private:
+	arena* _prev;
+public:
+	explicit arena_scope(arena& a);
+	~arena_scope();
+};
+
+template<class T, class... Args>
+inline T* new_node(Args&&... args){
+	return current_arena().create<T>(std::forward<Args>(args)...);
+}
+
+}//donkey
+
+#endif /*__arena_hpp__*/
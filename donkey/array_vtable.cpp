@@ -32,6 +32,12 @@ public:
 		return _data;
 	}
 	
+	void traverse(const child_visitor& visit){
+		for(integer i = 0; i < _cnt; ++i){
+			visit(_data[i]);
+		}
+	}
+	
 	integer size(){
 		return _cnt;
 	}
@@ -67,7 +73,7 @@ public:
 			p[i] = _data[j];
 		}
 		
-		variable ret(new array(p.get(), sz));
+		variable ret = variable::create_native<array>(p.get(), sz);
 		
 		p.release();
 		
@@ -84,7 +90,7 @@ public:
 			p[i] = (*arr->_data[i].get_vtable()->get_method("clone"))(arr->_data[i], ctx, 0);
 		}
 		
-		variable ret(new array(p.get(), arr->_cnt));
+		variable ret = variable::create_native<array>(p.get(), arr->_cnt);
 		
 		p.release();
 		
@@ -93,7 +99,7 @@ public:
 };
 
 variable create_initialized_array(variable* vars, size_t sz){
-	return variable(new array(vars, integer(sz)));
+	return variable::create_native<array>(vars, integer(sz));
 }
 
 std::pair<variable*, size_t> get_array_data_unsafe(const variable& v){
@@ -104,7 +110,7 @@ std::pair<variable*, size_t> get_array_data_unsafe(const variable& v){
 static variable create_array_helper(runtime_context& ctx, size_t current_param){
 	integer sz = ctx.top(current_param).as_integer();
 	
-	variable ret(new array(sz));
+	variable ret = variable::create_native<array>(sz);
 	
 	if(current_param > 0){
 		for(integer i = 0; i != sz; ++i){
@@ -117,7 +123,7 @@ static variable create_array_helper(runtime_context& ctx, size_t current_param){
 
 static variable create_array(runtime_context& ctx, size_t params_count){
 	if(params_count == 0){
-		return variable(new array(0));
+		return variable::create_native<array>(0);
 	}
 	return create_array_helper(ctx, params_count-1);
 }
@@ -138,6 +144,7 @@ vtable_ptr array_vtable(){
 		vtable* vt = new vtable("", "array", &create_array, std::move(methods), true);
 		
 		vt->derive_from(*object_vtable());
+		vt->set_traverser(&traverse_native<array>);
 		return vt;
 	}());
 	return ret;
@@ -0,0 +1,48 @@
+#include "atoms.hpp"
+#include "variables.hpp"
+
+#include <mutex>
+#include <unordered_set>
+#include <unordered_map>
+
+namespace donkey{
+
+namespace{
+
+std::mutex& atoms_mutex(){
+	static std::mutex* ret = new std::mutex();
+	return *ret;
+}
+
+//node based, so the strings never move
+std::unordered_set<std::string>& atoms(){
+	static std::unordered_set<std::string>* ret = new std::unordered_set<std::string>();
+	return *ret;
+}
+
+//per thread, because reference counts are not atomic; never destroyed, as the constants outlive the thread
+std::unordered_map<atom, variable>& string_constants(){
+	static thread_local std::unordered_map<atom, variable>* ret = nullptr;
+	if(!ret){
+		ret = new std::unordered_map<atom, variable>();
+	}
+	return *ret;
+}
+
+}//anonymous namespace
+
+atom get_atom(const std::string& s){
+	std::lock_guard<std::mutex> lock(atoms_mutex());
+	return &*atoms().insert(s).first;
+}
+
+variable get_string_constant(atom a){
+	std::unordered_map<atom, variable>& constants = string_constants();
+	auto it = constants.find(a);
+	if(it == constants.end()){
+		it = constants.emplace(a, variable(*a)).first;
+	}
+	return it->second;
+}
+
+}//donkey
@@ -0,0 +1,20 @@
+#ifndef __atoms_hpp__
+#define __atoms_hpp__
+
+#include <string>
+
+namespace donkey{
+
+class variable;
+
+//interned for the lifetime of the process; equal strings share one atom, so atoms compare by pointer
+typedef const std::string* atom;
+
+atom get_atom(const std::string& s);
+
+//string variable shared by all constants with the same text compiled on this thread
+variable get_string_constant(atom a);
+
+}//donkey
+
+#endif /*__atoms_hpp__*/
@@ -0,0 +1,28 @@
+#include "call_stack.hpp"
+
+namespace donkey{
+
+std::string call_stack::trace() const{
+	std::string ret;
+
+	size_t outer = 0;
+	if(_size > capacity){
+		outer = _size - capacity;
+	}
+
+	for(size_t i = _size; i != outer; --i){
+		const call_stack_entry& e = _frames[(i-1) % capacity];
+		for(const inlined_frame* f = e.inlined; f; f = f->outer){
+			ret += "\n\tat " + *f->name;
+		}
+		ret += "\n\tat " + *e.name;
+	}
+
+	if(outer){
+		ret += "\n\t(" + std::to_string(outer) + " more)";
+	}
+
+	return ret;
+}
+
+}//donkey
@@ -0,0 +1,85 @@
+#ifndef __call_stack_hpp__
+#define __call_stack_hpp__
+
+#include <cstddef>
+#include <string>
+
+namespace donkey{
+
+//a function whose body was inlined into the code of the frame it runs in
+struct inlined_frame{
+	const std::string* name;
+	const inlined_frame* outer; //the call site it was inlined into, if that one was inlined too
+};
+
+struct call_stack_entry{
+	const std::string* name;
+	const inlined_frame* inlined; //innermost inlined body running in the frame
+};
+
+//names of the functions running on this thread; read only when a runtime error is raised
+class call_stack{
+	call_stack(const call_stack&) = delete;
+	void operator=(const call_stack&) = delete;
+public:
+	static constexpr size_t capacity = 4096; //the innermost frames, named in traces; outer ones are only counted
+private:
+	call_stack_entry _frames[capacity]; //frame i is at i % capacity
+	size_t _size;
+public:
+	constexpr call_stack():
+		_frames(),
+		_size(0){
+	}
+
+	//returns the outer frame overwritten, which pop puts back
+	call_stack_entry push(const std::string& name){
+		call_stack_entry& slot = _frames[_size % capacity];
+		call_stack_entry ret = slot;
+		slot = call_stack_entry{&name, nullptr};
+		++_size;
+		return ret;
+	}
+
+	void pop(const call_stack_entry& overwritten){
+		--_size;
+		_frames[_size % capacity] = overwritten;
+	}
+
+	//for the innermost frame; nullptr once its code leaves the inlined bodies
+	void set_inlined(const inlined_frame* f){
+		if(_size){
+			_frames[(_size - 1) % capacity].inlined = f;
+		}
+	}
+
+	//innermost frame first, one "\n\tat name" line per frame, each preceded by the bodies inlined into it
+	std::string trace() const;
+};
+
+inline call_stack& current_call_stack(){
+	static thread_local call_stack ret;
+	return ret;
+}
+
+//the name must outlive the frame
+class call_stack_frame{
+	call_stack_frame(const call_stack_frame&) = delete;
+	void operator=(const call_stack_frame&) = delete;
+private:
+	call_stack& _stack;
+	call_stack_entry _overwritten;
+public:
+	call_stack_frame(const std::string& name):
+		_stack(current_call_stack()),
+		_overwritten(_stack.push(name)){
+	}
+
+	~call_stack_frame(){
+		_stack.pop(_overwritten);
+	}
+};
+
+}//donkey
+
+#endif /*__call_stack_hpp__*/
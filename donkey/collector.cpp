@@ -0,0 +1,428 @@
+#include "collector.hpp"
+#include "allocator.hpp"
+#include "variables.hpp"
+#include "vtable.hpp"
+
+#include <algorithm>
+
+namespace donkey{
+
+enum{
+	default_collection_threshold = 10000,
+	max_threshold_backoff = 64,
+	release_budget = 256,
+	safepoint_release_budget = 4096,
+};
+
+enum color: uint8_t{
+	black = 0,
+	gray,
+	white,
+	purple,
+};
+
+//payloads released while another payload is being destroyed are queued instead of destroyed recursively;
+//the queue is a stack, so destructors run in the order the recursion would have run them
+class deferred_releaser{
+	deferred_releaser(const deferred_releaser&) = delete;
+	void operator=(const deferred_releaser&) = delete;
+private:
+	struct entry{
+		heap_header* h;
+		bool is_object;
+	};
+
+	struct counter_guard{
+		size_t& counter;
+		counter_guard(size_t& c):
+			counter(++c){
+		}
+		~counter_guard(){
+			--counter;
+		}
+	};
+
+	std::vector<entry> _queue;
+	size_t _depth;
+	size_t _disposing;
+
+	//the queue is not drained while a destructor runs, so the queued destructors keep their order
+	void dispose(heap_header* h){
+		counter_guard disposing(_disposing);
+		//the variable does not own the reference, it only names the object for its destructor
+		variable that;
+		that._set_reference(h, var_type::object);
+		struct reference_guard{
+			variable& v;
+			~reference_guard(){
+				v._set_nothing();
+			}
+		} guard{that};
+		static_cast<donkey_object*>(h->payload())->dispose(that);
+	}
+
+	void destroy(const entry& e){
+		if(e.is_object && e.h->_vt->has_destructor()){
+			dispose(e.h);
+		}
+		counter_guard guard(_depth);
+		size_t sz = _queue.size();
+		e.h->destroy();
+		if(_depth == 1){
+			std::reverse(_queue.begin() + sz, _queue.end());
+		}
+	}
+
+	void release(const entry& e){
+		if(_depth){
+			_queue.push_back(e);
+			return;
+		}
+		destroy(e);
+		drain(release_budget);
+	}
+public:
+	deferred_releaser():
+		_depth(0),
+		_disposing(0){
+	}
+
+	static deferred_releaser& current(){
+		static thread_local deferred_releaser* ret = nullptr;
+		if(!ret){
+			ret = new deferred_releaser();
+		}
+		return *ret;
+	}
+
+	void release_object(heap_header* h){
+		release(entry{h, true});
+	}
+
+	//natives that cannot hold variables have nothing to defer
+	void release_native(heap_header* h){
+		if(h->_vt->get_traverser()){
+			release(entry{h, false});
+		}else{
+			destroy(entry{h, false});
+		}
+	}
+
+	//does nothing while a payload is being destroyed or a destructor runs
+	void drain(size_t budget){
+		if(_depth || _disposing){
+			return;
+		}
+		for(; budget && !_queue.empty(); --budget){
+			entry e = _queue.back();
+			_queue.pop_back();
+			destroy(e);
+		}
+	}
+
+	void flush(){
+		while(!_depth && !_disposing && !_queue.empty()){
+			drain(safepoint_release_budget);
+		}
+	}
+};
+
+class cycle_collector{
+	cycle_collector(const cycle_collector&) = delete;
+	void operator=(const cycle_collector&) = delete;
+private:
+	struct node{
+		heap_header* h;
+		bool is_object;
+	};
+
+	std::vector<node> _roots;
+	size_t _threshold;
+	size_t _limit;
+	bool _pending;
+	bool _collecting;
+
+	static size_t bytes_in_use(){
+		size_t ret = 0;
+		for(const allocation_stats& s: get_allocation_stats()){
+			ret += s.bytes_in_use;
+		}
+		return ret;
+	}
+
+	static bool is_collectable(const variable& v){
+		switch(v._type()){
+			case var_type::object:
+				return true;
+			case var_type::native:
+				return v._reference()->_vt->get_traverser() != nullptr;
+			default:
+				return false;
+		}
+	}
+
+	template<typename F>
+	static void for_each_child(const node& n, F f){
+		heap_header* h = n.h;
+		if(h->_deleter == nullptr){
+			return;
+		}
+		auto visit = [&f](variable& v){
+			if(is_collectable(v)){
+				f(node{v._reference(), v._type() == var_type::object});
+			}
+		};
+		if(n.is_object){
+			donkey_object* o = static_cast<donkey_object*>(h->payload());
+			for(size_t i = 0; i != o->get_fields_size(); ++i){
+				visit(o->get_field(i));
+			}
+		}else{
+			h->_vt->get_traverser()(h->payload(), visit);
+		}
+	}
+
+	static void clear(const node& n){
+		heap_header* h = n.h;
+		if(h->_deleter == nullptr){
+			return;
+		}
+		if(n.is_object){
+			donkey_object* o = static_cast<donkey_object*>(h->payload());
+			for(size_t i = 0; i != o->get_fields_size(); ++i){
+				o->get_field(i).reset();
+			}
+		}else{
+			h->_vt->get_traverser()(h->payload(), [](variable& v){
+				v.reset();
+			});
+		}
+	}
+
+	//subtracts the references coming from inside the subgraph
+	static void mark_gray(const node& root){
+		if(root.h->_color == gray){
+			return;
+		}
+		root.h->_color = gray;
+		std::vector<node> stack(1, root);
+		while(!stack.empty()){
+			node n = stack.back();
+			stack.pop_back();
+			for_each_child(n, [&stack](const node& c){
+				--c.h->_s_count;
+				if(c.h->_color != gray){
+					c.h->_color = gray;
+					stack.push_back(c);
+				}
+			});
+		}
+	}
+
+	//restores the references of everything reachable from outside
+	static void scan_black(const node& root){
+		root.h->_color = black;
+		std::vector<node> stack(1, root);
+		while(!stack.empty()){
+			node n = stack.back();
+			stack.pop_back();
+			for_each_child(n, [&stack](const node& c){
+				++c.h->_s_count;
+				if(c.h->_color != black){
+					c.h->_color = black;
+					stack.push_back(c);
+				}
+			});
+		}
+	}
+
+	static void scan(const node& root){
+		std::vector<node> stack(1, root);
+		while(!stack.empty()){
+			node n = stack.back();
+			stack.pop_back();
+			if(n.h->_color != gray){
+				continue;
+			}
+			if(n.h->_s_count > 0){
+				scan_black(n);
+			}else{
+				n.h->_color = white;
+				for_each_child(n, [&stack](const node& c){
+					stack.push_back(c);
+				});
+			}
+		}
+	}
+
+	static void collect_white(const node& root, std::vector<node>& garbage){
+		std::vector<node> stack(1, root);
+		while(!stack.empty()){
+			node n = stack.back();
+			stack.pop_back();
+			if(n.h->_color != white || n.h->_buffered){
+				continue;
+			}
+			n.h->_color = black;
+			garbage.push_back(n);
+			for_each_child(n, [&stack](const node& c){
+				stack.push_back(c);
+			});
+		}
+	}
+
+public:
+	cycle_collector():
+		_threshold(default_collection_threshold),
+		_limit(default_collection_threshold),
+		_pending(false),
+		_collecting(false){
+	}
+
+	static cycle_collector& current(){
+		static thread_local cycle_collector* ret = nullptr;
+		if(!ret){
+			ret = new cycle_collector();
+		}
+		return *ret;
+	}
+
+	void possible_root(heap_header* h, bool is_object){
+		if(!is_object && h->_vt->get_traverser() == nullptr){
+			return;
+		}
+		h->_color = purple;
+		h->_buffered = true;
+		h->add_weak();
+		_roots.push_back(node{h, is_object});
+		if(_threshold && _roots.size() >= _limit){
+			_pending = true;
+		}
+	}
+
+	void set_threshold(size_t threshold){
+		_threshold = threshold;
+		_limit = threshold;
+	}
+
+	void safepoint(){
+		deferred_releaser::current().drain(safepoint_release_budget);
+		if(_pending){
+			collect();
+		}
+	}
+
+	collection_result collect(){
+		collection_result ret{0, 0};
+		if(_collecting){
+			return ret;
+		}
+		_collecting = true;
+		_pending = false;
+		
+		struct collecting_guard{
+			bool& collecting;
+			~collecting_guard(){
+				collecting = false;
+			}
+		} guard{_collecting};
+
+		deferred_releaser::current().flush();
+		size_t bytes_before = bytes_in_use();
+
+		std::vector<node> roots;
+		roots.swap(_roots);
+
+		std::vector<node> candidates;
+		for(const node& n: roots){
+			heap_header* h = n.h;
+			if(h->_color == purple && h->_s_count > 0){
+				mark_gray(n);
+				candidates.push_back(n);
+			}else{
+				h->_buffered = false;
+				if(h->_color == purple){
+					h->_color = black;
+				}
+				h->remove_weak();
+			}
+		}
+
+		for(const node& n: candidates){
+			scan(n);
+		}
+
+		std::vector<node> garbage;
+		for(const node& n: candidates){
+			n.h->_buffered = false;
+			collect_white(n, garbage);
+		}
+
+		for(const node& n: garbage){
+			for_each_child(n, [](const node& c){
+				++c.h->_s_count;
+			});
+		}
+
+		//cycles are broken by clearing the garbage; reference counting then releases it
+		{
+			std::vector<variable> pinned(garbage.size());
+			for(size_t i = 0; i != garbage.size(); ++i){
+				garbage[i].h->add_shared();
+				pinned[i]._set_reference(garbage[i].h, garbage[i].is_object ? var_type::object : var_type::native);
+			}
+			for(const node& n: garbage){
+				clear(n);
+			}
+		}
+
+		for(const node& n: candidates){
+			n.h->remove_weak();
+		}
+
+		deferred_releaser::current().flush();
+		size_t bytes_after = bytes_in_use();
+
+		//collections that find little garbage are spaced out, so big live structures are not rescanned all the time
+		if(garbage.size() * 2 < roots.size()){
+			_limit = std::min(_limit * 2, _threshold * max_threshold_backoff);
+		}else{
+			_limit = _threshold;
+		}
+
+		ret.objects = garbage.size();
+		ret.bytes = bytes_before > bytes_after ? bytes_before - bytes_after : 0;
+
+		return ret;
+	}
+};
+
+void release_dead_object(heap_header* h){
+	deferred_releaser::current().release_object(h);
+}
+
+void release_dead_native(heap_header* h){
+	deferred_releaser::current().release_native(h);
+}
+
+void flush_deferred_releases(){
+	deferred_releaser::current().flush();
+}
+
+void possible_cycle_root(heap_header* h, bool is_object){
+	cycle_collector::current().possible_root(h, is_object);
+}
+
+collection_result collect_cycles(){
+	return cycle_collector::current().collect();
+}
+
+void set_cycle_collection_threshold(size_t possible_roots){
+	cycle_collector::current().set_threshold(possible_roots);
+}
+
+void collection_safepoint(){
+	cycle_collector::current().safepoint();
+}
+
+}//donkey
@@ -0,0 +1,27 @@
+#ifndef __collector_hpp__
+#define __collector_hpp__
+
+#include <cstddef>
+
+namespace donkey{
+
+struct collection_result{
+	size_t objects;
+	size_t bytes;
+};
+
+//trial deletion over objects, arrays and containers whose reference count dropped without reaching zero
+collection_result collect_cycles();
+
+//number of possible cycle roots that triggers a collection at the next safepoint; 0 disables it
+void set_cycle_collection_threshold(size_t possible_roots);
+
+//destroys queued dead objects, arrays and containers; they are otherwise released in small batches
+void flush_deferred_releases();
+
+//drains part of the deferred release queue and runs a pending cycle collection
+void collection_safepoint();
+
+}//donkey
+
+#endif /*__collector_hpp__*/
@@ -12,26 +12,50 @@ void compile_if(scope& target, tokenizer& parser){
 	std::vector<expression_ptr> es;
 	std::vector<statement> ss;
 	
+	//branches behind a constant true condition are parsed, but never reached
+	bool reached = true;
+	bool has_else = false;
+	
 	do{
 		++parser;
 		parse("(", parser);
-		es.push_back(build_expression(target, parser, false));
+		expression_ptr e = build_expression(target, parser, false);
 		parse(")", parser);
 		scope s(&target);
 		compile_statement(s, parser);
-		ss.push_back(s.get_block());
+		
+		bool cond;
+		if(!reached || (get_constant_condition(e, cond) && !cond)){
+			continue;
+		}
+		
+		if(get_constant_condition(e, cond)){
+			ss.push_back(s.get_block());
+			has_else = true;
+			reached = false;
+		}else{
+			es.push_back(e);
+			ss.push_back(s.get_block());
+		}
 	}while(*parser == "elif");
 	
 	if(*parser == "else"){
 		++parser;
 		scope s(&target);
 		compile_statement(s, parser);
-		ss.push_back(s.get_block());
-	}else{
+		if(reached){
+			ss.push_back(s.get_block());
+			has_else = true;
+		}
+	}
+	
+	if(!has_else){
 		ss.push_back(&empty_statement);
 	}
 	
-	if(es.size() == 1){
+	if(es.empty()){
+		target.add_statement(std::move(ss.back()));
+	}else if(es.size() == 1){
 		if(ss.size() == 1){
 			target.add_statement(simple_if_statement(es.front(), std::move(ss.front())));
 		}else{
@@ -46,7 +70,8 @@ void compile_switch(scope& target, tokenizer& parser){
 	if(target.is_class()){
 		unexpected_error(*parser);
 	}
-	std::unordered_map<number, size_t> cases;
+	std::unordered_map<number, int32_t> cases;
+	std::unordered_map<std::string, int32_t> string_cases;
 	size_t dflt = 0;
 	bool has_dflt = false;
 	
@@ -68,24 +93,42 @@ void compile_switch(scope& target, tokenizer& parser){
 			if(!has_dflt){
 				dflt = s.get_number_of_statements();
 			}
-			target.add_statement(switch_statement(e, s.get_statements(), std::move(cases), dflt));
+			if(string_cases.empty()){
+				target.add_statement(switch_statement(e, s.get_statements(), number_switch(cases, dflt)));
+			}else{
+				target.add_statement(switch_statement(e, s.get_statements(), string_switch(string_cases, dflt)));
+			}
 			return;
 		}
 		if(*parser == "case"){
 			++parser;
 			
+			std::string label = *parser;
 			constant c = get_const(target, parser);
 			
-			if(!c.is_number){
-				syntax_error("number expected");
-			}
-			
-			if(cases.find(c.n) != cases.end()){
-				semantic_error("duplicated case " + *parser);
+			//the first case decides whether the switch is on numbers or on strings
+			if(c.is_number){
+				if(!string_cases.empty()){
+					syntax_error("string expected");
+				}
+				if(cases.find(c.n) != cases.end()){
+					semantic_error("duplicated case " + label);
+				}
+			}else{
+				if(!cases.empty()){
+					syntax_error("number expected");
+				}
+				if(string_cases.find(c.s) != string_cases.end()){
+					semantic_error("duplicated case " + label);
+				}
 			}
 			
 			parse(":", parser);
-			cases[c.n] = s.get_number_of_statements();
+			if(c.is_number){
+				cases[c.n] = s.get_number_of_statements();
+			}else{
+				string_cases[c.s] = s.get_number_of_statements();
+			}
 		}else if(*parser == "default"){
 			++parser;
 			if(has_dflt){
@@ -0,0 +1,823 @@
+#include "bytecode_compiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace donkey{
+
+typedef statement_retval(*statement_function)(runtime_context&);
+
+inline bool is_jump(vm_op op){
+	switch(op){
+		case vm_op::jump:
+		case vm_op::jump_if:
+		case vm_op::jump_less:
+		case vm_op::jump_greater:
+		case vm_op::jump_less_equal:
+		case vm_op::jump_greater_equal:
+		case vm_op::jump_equal:
+		case vm_op::jump_unequal:
+		case vm_op::num_jump_less:
+		case vm_op::num_jump_greater:
+		case vm_op::num_jump_less_equal:
+		case vm_op::num_jump_greater_equal:
+		case vm_op::num_jump_equal:
+		case vm_op::num_jump_unequal:
+		case vm_op::num_loop_less:
+		case vm_op::num_loop_greater:
+		case vm_op::num_loop_less_equal:
+		case vm_op::num_loop_greater_equal:
+		case vm_op::num_loop_unequal:
+		case vm_op::jump_expression:
+			return true;
+		default:
+			return false;
+	}
+}
+
+inline bool to_loop_op(vm_op op, vm_op& loop_op){
+	switch(op){
+		case vm_op::num_jump_less:          loop_op = vm_op::num_loop_less; return true;
+		case vm_op::num_jump_greater:       loop_op = vm_op::num_loop_greater; return true;
+		case vm_op::num_jump_less_equal:    loop_op = vm_op::num_loop_less_equal; return true;
+		case vm_op::num_jump_greater_equal: loop_op = vm_op::num_loop_greater_equal; return true;
+		case vm_op::num_jump_unequal:       loop_op = vm_op::num_loop_unequal; return true;
+		default:                            return false;
+	}
+}
+
+inline vm_op to_vm_op(oper op){
+	switch(op){
+		case oper::mul:               return vm_op::mul;
+		case oper::div:               return vm_op::div;
+		case oper::idiv:              return vm_op::idiv;
+		case oper::mod:               return vm_op::mod;
+		case oper::plus:              return vm_op::plus;
+		case oper::minus:             return vm_op::minus;
+		case oper::shiftl:            return vm_op::shiftl;
+		case oper::shiftr:            return vm_op::shiftr;
+		case oper::bitwise_and:       return vm_op::bitwise_and;
+		case oper::bitwise_xor:       return vm_op::bitwise_xor;
+		case oper::bitwise_or:        return vm_op::bitwise_or;
+		case oper::less:              return vm_op::less;
+		case oper::greater:           return vm_op::greater;
+		case oper::less_equal:        return vm_op::less_equal;
+		case oper::greater_equal:     return vm_op::greater_equal;
+		case oper::equal:             return vm_op::equal;
+		case oper::unequal:           return vm_op::unequal;
+		case oper::unary_plus:        return vm_op::unary_plus;
+		case oper::unary_minus:       return vm_op::unary_minus;
+		case oper::bitwise_not:       return vm_op::bitwise_not;
+		case oper::logical_not:       return vm_op::logical_not;
+		case oper::pre_inc:           return vm_op::pre_inc;
+		case oper::pre_dec:           return vm_op::pre_dec;
+		case oper::post_inc:          return vm_op::post_inc;
+		case oper::post_dec:          return vm_op::post_dec;
+		case oper::mul_assignment:    return vm_op::mul_assignment;
+		case oper::div_assignment:    return vm_op::div_assignment;
+		case oper::mod_assignment:    return vm_op::mod_assignment;
+		case oper::plus_assignment:   return vm_op::plus_assignment;
+		case oper::minus_assignment:  return vm_op::minus_assignment;
+		case oper::shiftl_assignment: return vm_op::shiftl_assignment;
+		case oper::shiftr_assignment: return vm_op::shiftr_assignment;
+		case oper::and_assignment:    return vm_op::and_assignment;
+		case oper::xor_assignment:    return vm_op::xor_assignment;
+		case oper::or_assignment:     return vm_op::or_assignment;
+		default:                      return vm_op::count;
+	}
+}
+
+//variants without type checks, for operands known to be numbers
+inline vm_op to_num_op(oper op){
+	switch(op){
+		case oper::mul:              return vm_op::num_mul;
+		case oper::div:              return vm_op::num_div;
+		case oper::mod:              return vm_op::num_mod;
+		case oper::plus:             return vm_op::num_plus;
+		case oper::minus:            return vm_op::num_minus;
+		case oper::less:             return vm_op::num_less;
+		case oper::greater:          return vm_op::num_greater;
+		case oper::less_equal:       return vm_op::num_less_equal;
+		case oper::greater_equal:    return vm_op::num_greater_equal;
+		case oper::equal:            return vm_op::num_equal;
+		case oper::unequal:          return vm_op::num_unequal;
+		case oper::pre_inc:          return vm_op::num_pre_inc;
+		case oper::pre_dec:          return vm_op::num_pre_dec;
+		case oper::post_inc:         return vm_op::num_post_inc;
+		case oper::post_dec:         return vm_op::num_post_dec;
+		case oper::mul_assignment:   return vm_op::num_mul_assignment;
+		case oper::div_assignment:   return vm_op::num_div_assignment;
+		case oper::mod_assignment:   return vm_op::num_mod_assignment;
+		case oper::plus_assignment:  return vm_op::num_plus_assignment;
+		case oper::minus_assignment: return vm_op::num_minus_assignment;
+		default:                     return to_vm_op(op);
+	}
+}
+
+inline vm_op to_num_jump_op(oper op){
+	switch(op){
+		case oper::less:          return vm_op::num_jump_less;
+		case oper::greater:       return vm_op::num_jump_greater;
+		case oper::less_equal:    return vm_op::num_jump_less_equal;
+		case oper::greater_equal: return vm_op::num_jump_greater_equal;
+		case oper::equal:         return vm_op::num_jump_equal;
+		case oper::unequal:       return vm_op::num_jump_unequal;
+		default:                  return vm_op::count;
+	}
+}
+
+inline vm_op to_jump_op(oper op){
+	switch(op){
+		case oper::less:          return vm_op::jump_less;
+		case oper::greater:       return vm_op::jump_greater;
+		case oper::less_equal:    return vm_op::jump_less_equal;
+		case oper::greater_equal: return vm_op::jump_greater_equal;
+		case oper::equal:         return vm_op::jump_equal;
+		case oper::unequal:       return vm_op::jump_unequal;
+		default:                  return vm_op::count;
+	}
+}
+
+inline bool is_number_constant(const expression_ptr& e, number n){
+	variable v;
+	return e->get_constant(v) && v.get_var_type() == var_type::number && v.as_number_unsafe() == n;
+}
+
+//x*1, 1*x, x-0 and x/1 are x once x is known to be a number; x+0 is not, as it turns -0 into 0
+inline expression_ptr identity_operand(oper op, const expression_ptr& e1, const expression_ptr& e2){
+	switch(op){
+		case oper::mul:
+			if(is_number_constant(e1, 1) && e2->is_numeric()){
+				return e2;
+			}
+			return is_number_constant(e2, 1) && e1->is_numeric() ? e1 : expression_ptr();
+		case oper::div:
+			return is_number_constant(e2, 1) && e1->is_numeric() ? e1 : expression_ptr();
+		case oper::minus:
+			return is_number_constant(e2, 0) && e1->is_numeric() ? e1 : expression_ptr();
+		default:
+			return expression_ptr();
+	}
+}
+
+bytecode_builder::bytecode_builder(int base, int temps_base, bool tail_calls):
+	_p(new program()),
+	_base(base),
+	_depth(base),
+	_max_depth(base),
+	_temps_base(temps_base),
+	_temps(0),
+	_max_temps(0),
+	_tail_calls(tail_calls),
+	_tail(false),
+	_locals_base(0){
+}
+
+int bytecode_builder::constant(const variable& v){
+	std::vector<variable>& constants = _p->_constants;
+
+	//0 and -0 compare equal, but must not share a slot
+	if(v.get_var_type() == var_type::number || v.get_var_type() == var_type::nothing){
+		for(size_t i = 0; i != constants.size(); ++i){
+			if(constants[i].get_var_type() == v.get_var_type() &&
+			   (v.get_var_type() == var_type::nothing ||
+			    (constants[i].as_number_unsafe() == v.as_number_unsafe() &&
+			     std::signbit(constants[i].as_number_unsafe()) == std::signbit(v.as_number_unsafe())))){
+				return ~int(i);
+			}
+		}
+	}
+
+	constants.push_back(v);
+	return ~int(constants.size() - 1);
+}
+
+int bytecode_builder::expression_index(const expression_ptr& e){
+	_p->_expressions.push_back(e);
+	return _p->_expressions.size() - 1;
+}
+
+int bytecode_builder::statement_index(const statement& s){
+	_p->_statements.push_back(s);
+	return _p->_statements.size() - 1;
+}
+
+int bytecode_builder::temp(){
+	int ret = _temps_base + _temps++;
+	_max_temps = std::max(_max_temps, _temps);
+	return ret;
+}
+
+int bytecode_builder::temps(int cnt){
+	int ret = _temps_base + _temps;
+	_temps += cnt;
+	_max_temps = std::max(_max_temps, _temps);
+	return ret;
+}
+
+int bytecode_builder::new_label(){
+	_labels.push_back(-1);
+	return _labels.size() - 1;
+}
+
+void bytecode_builder::bind(int label){
+	_labels[label] = _p->_code.size();
+}
+
+void bytecode_builder::emit(vm_op op, int a, int b, int c, int d){
+	_p->_code.push_back(instruction{op, a, b, c, d});
+}
+
+void bytecode_builder::value(const expression_ptr& e, int dst){
+	int mark = _temps;
+
+	if(!e->lower(*this, dst)){
+		if(dst >= 0){
+			emit(vm_op::eval, dst, expression_index(e));
+		}else{
+			emit(vm_op::exec, expression_index(e));
+		}
+	}
+
+	_temps = mark;
+}
+
+int bytecode_builder::operand(const expression_ptr& e){
+	int r;
+	if(e->lower_operand(*this, r)){
+		return r;
+	}
+	r = temp();
+	value(e, r);
+	return r;
+}
+
+void bytecode_builder::operands(const expression_ptr& e1, const expression_ptr& e2, int& l, int& r){
+	if(!e1->lower_operand(*this, l)){
+		l = temp();
+		value(e1, l);
+	}else if(l >= 0 && !e2->lower_operand(*this, r)){
+		//e2 may assign to the local; the left operand is its value from before
+		int t = temp();
+		emit(vm_op::move, t, l);
+		l = t;
+	}
+	r = operand(e2);
+}
+
+void bytecode_builder::branch(const expression_ptr& e, bool when, int label){
+	bool cond;
+	if(get_constant_condition(e, cond)){
+		if(cond == when){
+			emit(vm_op::jump, label);
+		}
+		return;
+	}
+	
+	int mark = _temps;
+
+	if(!e->lower_branch(*this, when, label)){
+		int r;
+		if(e->lower_operand(*this, r)){
+			emit(vm_op::jump_if, label, r, 0, when);
+		}else{
+			r = temp();
+			if(e->lower(*this, r)){
+				emit(vm_op::jump_if, label, r, 0, when);
+			}else{
+				emit(vm_op::jump_expression, label, expression_index(e), 0, when);
+			}
+		}
+	}
+
+	_temps = mark;
+}
+
+void bytecode_builder::materialize(expression& e, int dst){
+	int f = new_label();
+
+	e.lower_branch(*this, false, f);
+
+	if(dst >= 0){
+		int end = new_label();
+		emit(vm_op::move, dst, constant(variable(number(1))));
+		emit(vm_op::jump, end);
+		bind(f);
+		emit(vm_op::move, dst, constant(variable(number(0))));
+		bind(end);
+	}else{
+		bind(f);
+	}
+}
+
+void bytecode_builder::unary(oper op, const expression_ptr& e, int dst){
+	int r = operand(e);
+	emit(to_vm_op(op), target(dst), r);
+}
+
+void bytecode_builder::binary(oper op, const expression_ptr& e1, const expression_ptr& e2, int dst){
+	if(expression_ptr e = identity_operand(op, e1, e2)){
+		value(e, dst);
+		return;
+	}
+	
+	vm_op vop = e1->is_numeric() && e2->is_numeric() ? to_num_op(op) : to_vm_op(op);
+	int l;
+	int r;
+	operands(e1, e2, l, r);
+	emit(vop, target(dst), l, r);
+}
+
+bool bytecode_builder::compare(oper op, const expression_ptr& e1, const expression_ptr& e2, bool when, int label){
+	vm_op jop = e1->is_numeric() && e2->is_numeric() ? to_num_jump_op(op) : to_jump_op(op);
+	if(jop == vm_op::count){
+		return false;
+	}
+
+	int l;
+	int r;
+	operands(e1, e2, l, r);
+	emit(jop, label, l, r, when);
+	return true;
+}
+
+bool bytecode_builder::increment(oper op, const expression_ptr& e, int dst){
+	int slot;
+	if(!e->lower_operand(*this, slot) || slot < 0){
+		return false;
+	}
+
+	vm_op vop = e->is_numeric() ? to_num_op(op) : to_vm_op(op);
+	if(op == oper::post_inc || op == oper::post_dec){
+		emit(vop, target(dst), slot);
+	}else{
+		emit(vop, slot);
+		if(dst >= 0 && dst != slot){
+			emit(vm_op::move, dst, slot);
+		}
+	}
+	return true;
+}
+
+bool bytecode_builder::compound_assignment(oper op, const expression_ptr& e1, const expression_ptr& e2, int dst){
+	int slot;
+	if(!e1->lower_operand(*this, slot) || slot < 0){
+		return false;
+	}
+
+	vm_op vop = e1->is_numeric() && e2->is_numeric() ? to_num_op(op) : to_vm_op(op);
+	int r = operand(e2);
+	emit(vop, slot, r);
+	if(dst >= 0 && dst != slot){
+		emit(vm_op::move, dst, slot);
+	}
+	return true;
+}
+
+int bytecode_builder::arguments(const std::vector<expression_ptr>& params){
+	int first = temps(params.size());
+	for(size_t i = 0; i != params.size(); ++i){
+		value(params[i], first + i);
+	}
+	return first;
+}
+
+void bytecode_builder::call(const expression_ptr& f, const std::vector<expression_ptr>& params, int dst){
+	if(f->lower_call(*this, params, dst)){
+		return;
+	}
+
+	int mark = _temps;
+
+	int fr;
+	bool direct = f->lower_operand(*this, fr);
+
+	int first = arguments(params);
+
+	if(direct){
+		emit(vm_op::call, dst, first, params.size(), fr);
+	}else{
+		emit(vm_op::call_expression, dst, first, params.size(), expression_index(f));
+	}
+
+	_temps = mark;
+}
+
+void bytecode_builder::inline_call(const inline_function& f, const std::vector<expression_ptr>& params, int dst){
+	int mark = _temps;
+
+	//the params get slots of their own, as in a call; extra arguments are evaluated and dropped
+	int first = temps(f.params_count);
+	for(size_t i = 0; i != params.size(); ++i){
+		value(params[i], i < f.params_count ? first + int(i) : -1);
+	}
+	if(params.size() < f.params_count){
+		emit(vm_op::clear, first + params.size(), f.params_count - params.size());
+	}
+
+	int site = int(_inlined.size());
+	_inlined.push_back(f.name);
+	_inlined_outer.push_back(_inline_sites.empty() ? -1 : _inline_sites.back());
+
+	int locals_base = _locals_base;
+	_locals_base = first;
+	_inlining.push_back(&f);
+	_inline_sites.push_back(site);
+	emit(vm_op::enter_inline, site);
+	value(f.e, dst);
+	emit(vm_op::leave_inline, site);
+	_inline_sites.pop_back();
+	_inlining.pop_back();
+	_locals_base = locals_base;
+
+	_temps = mark;
+}
+
+void bytecode_builder::call_function(code_address f, const inline_function* inl, const std::vector<expression_ptr>& params, int dst){
+	int mark = _temps;
+	bool tail = _tail;
+	_tail = false;
+
+	//not into itself, and not deeper than a few helpers calling helpers
+	if(inl && inl->e && _inlining.size() < 4 && std::find(_inlining.begin(), _inlining.end(), inl) == _inlining.end()){
+		if(tail){
+			int r = temp();
+			inline_call(*inl, params, r);
+			emit(vm_op::ret, r, 0, 0, 1);
+		}else{
+			inline_call(*inl, params, dst);
+		}
+		_temps = mark;
+		return;
+	}
+
+	std::vector<callee>& callees = _p->_callees;
+	size_t idx = 0;
+	while(idx != callees.size() && callees[idx].address != f){
+		++idx;
+	}
+	if(idx == callees.size()){
+		callees.push_back(callee{f, nullptr, nullptr});
+	}
+
+	int first = arguments(params);
+	emit(tail ? vm_op::tail_call_function : vm_op::call_function, dst, first, params.size(), idx);
+
+	_temps = mark;
+}
+
+bool bytecode_builder::tail_call(const expression_ptr& f, const std::vector<expression_ptr>& params){
+	if(!_tail_calls){
+		return false;
+	}
+	_tail = true;
+	bool ret = f->lower_call(*this, params, -1);
+	_tail = false;
+	return ret;
+}
+
+void bytecode_builder::loop_step(const expression_ptr& step, const expression_ptr& cond, int body){
+	std::vector<instruction>& code = _p->_code;
+
+	size_t step_at = code.size();
+	value(step, -1);
+	size_t cond_at = code.size();
+	branch(cond, true, body);
+
+	//a numeric counter updated by a constant and compared to a numeric bound
+	vm_op loop_op;
+	if(cond_at - step_at != 1 || code.size() - cond_at != 1 || !to_loop_op(code[cond_at].op, loop_op) || !code[cond_at].d){
+		return;
+	}
+
+	int counter;
+	int delta;
+	const instruction& s = code[step_at];
+	switch(s.op){
+		case vm_op::num_pre_inc:
+		case vm_op::num_post_inc:
+			counter = s.op == vm_op::num_pre_inc ? s.a : s.b;
+			delta = constant(variable(number(1)));
+			break;
+		case vm_op::num_pre_dec:
+		case vm_op::num_post_dec:
+			counter = s.op == vm_op::num_pre_dec ? s.a : s.b;
+			delta = constant(variable(number(-1)));
+			break;
+		case vm_op::num_plus_assignment:
+			if(s.b >= 0){
+				return;
+			}
+			counter = s.a;
+			delta = s.b;
+			break;
+		case vm_op::num_minus_assignment:
+			if(s.b >= 0){
+				return;
+			}
+			counter = s.a;
+			delta = constant(variable(-_p->_constants[~s.b].as_number_unsafe()));
+			break;
+		default:
+			return;
+	}
+
+	const instruction& c = code[cond_at];
+	if(c.b != counter){
+		return;
+	}
+
+	code[step_at] = instruction{loop_op, c.a, counter, c.c, delta};
+	code.pop_back();
+}
+
+void bytecode_builder::ret(const expression_ptr& e){
+	if(e->lower_tail_call(*this)){
+		return;
+	}
+
+	int mark = _temps;
+
+	int r;
+	if(e->lower_operand(*this, r)){
+		emit(vm_op::ret, r);
+	}else{
+		r = temp();
+		value(e, r);
+		emit(vm_op::ret, r, 0, 0, 1);
+	}
+
+	_temps = mark;
+}
+
+void bytecode_builder::add(const statement& s){
+#define LOWER_STATEMENT(type)\
+	if(const type* p = s.target<type>()){\
+		p->lower(*this);\
+		return;\
+	}
+
+	LOWER_STATEMENT(expression_statement)
+	LOWER_STATEMENT(vars_block_statement)
+	LOWER_STATEMENT(block_statement)
+	LOWER_STATEMENT(for_statement)
+	LOWER_STATEMENT(while_statement)
+	LOWER_STATEMENT(do_statement)
+	LOWER_STATEMENT(if_statement)
+	LOWER_STATEMENT(simple_if_statement)
+	LOWER_STATEMENT(if_else_statement)
+	LOWER_STATEMENT(switch_statement)
+	LOWER_STATEMENT(return_statement)
+
+#undef LOWER_STATEMENT
+
+	if(const statement_function* f = s.target<statement_function>()){
+		if(*f == &empty_statement){
+			return;
+		}
+		if(*f == &break_statement){
+			break_jump();
+			return;
+		}
+		if(*f == &continue_statement){
+			continue_jump();
+			return;
+		}
+	}
+
+	//base constructor/destructor calls and anything else stay in the tree
+	emit(vm_op::exec_statement, statement_index(s));
+}
+
+int bytecode_builder::enter_block(int locals_count){
+	int ret = _depth;
+	_depth += locals_count;
+	_max_depth = std::max(_max_depth, _depth);
+	return ret;
+}
+
+void bytecode_builder::clear_to(int depth){
+	if(_depth > depth){
+		emit(vm_op::clear, depth, _depth - depth);
+	}
+}
+
+void bytecode_builder::leave_block(int depth){
+	clear_to(depth);
+	_depth = depth;
+}
+
+void bytecode_builder::enter_loop(int brk, int cnt){
+	_targets.push_back(jump_target{brk, _depth, cnt, _depth});
+}
+
+void bytecode_builder::enter_switch(int brk){
+	jump_target t{brk, _depth, -1, -1};
+	if(!_targets.empty()){
+		t.cnt = _targets.back().cnt;
+		t.cnt_depth = _targets.back().cnt_depth;
+	}
+	_targets.push_back(t);
+}
+
+void bytecode_builder::leave_loop(){
+	_targets.pop_back();
+}
+
+void bytecode_builder::break_jump(){
+	const jump_target& t = _targets.back();
+	clear_to(t.brk_depth);
+	emit(vm_op::jump, t.brk);
+}
+
+void bytecode_builder::continue_jump(){
+	const jump_target& t = _targets.back();
+	clear_to(t.cnt_depth);
+	emit(vm_op::jump, t.cnt);
+}
+
+void bytecode_builder::switch_jump(int r, number_switch&& cases){
+	_switches.push_back(std::move(cases));
+	emit(vm_op::switch_number, r, _switches.size() - 1);
+}
+
+void bytecode_builder::switch_jump(int r, string_switch&& cases){
+	_string_switches.push_back(std::move(cases));
+	emit(vm_op::switch_string, r, _string_switches.size() - 1);
+}
+
+program_ptr bytecode_builder::finish(){
+	for(instruction& i: _p->_code){
+		if(is_jump(i.op)){
+			i.a = _labels[i.a];
+		}
+	}
+
+	auto resolve = [this](int32_t label){
+		return _labels[label];
+	};
+	for(number_switch& cases: _switches){
+		cases.map_targets(resolve);
+	}
+	for(string_switch& cases: _string_switches){
+		cases.map_targets(resolve);
+	}
+	_p->_switches = std::move(_switches);
+	_p->_string_switches = std::move(_string_switches);
+	_p->_inlined = std::move(_inlined);
+	_p->_inlined_outer = std::move(_inlined_outer);
+	_p->link_inlined_frames();
+
+	_p->_frame_size = std::max(_temps_base + _max_temps, _max_depth) - _base;
+
+	return _p;
+}
+
+void expression_statement::lower(bytecode_builder& b) const{
+	b.value(_e, -1);
+}
+
+void vars_block_statement::lower(bytecode_builder& b) const{
+	int depth = b.enter_block(_locals_count);
+	for(const statement& s: _ss){
+		b.add(s);
+	}
+	b.leave_block(depth);
+}
+
+void block_statement::lower(bytecode_builder& b) const{
+	for(const statement& s: _ss){
+		b.add(s);
+	}
+}
+
+void for_statement::lower(bytecode_builder& b) const{
+	int body = b.new_label();
+	int step = b.new_label();
+	int end = b.new_label();
+
+	//the condition is tested on entry and again after each step, which lets counted loops fuse the two
+	b.value(_e1, -1);
+	b.branch(_e2, false, end);
+	b.bind(body);
+	b.enter_loop(end, step);
+	b.add(_s);
+	b.leave_loop();
+	b.bind(step);
+	b.loop_step(_e3, _e2, body);
+	b.bind(end);
+}
+
+void while_statement::lower(bytecode_builder& b) const{
+	int body = b.new_label();
+	int cond = b.new_label();
+	int end = b.new_label();
+
+	b.emit(vm_op::jump, cond);
+	b.bind(body);
+	b.enter_loop(end, cond);
+	b.add(_s);
+	b.leave_loop();
+	b.bind(cond);
+	b.branch(_e, true, body);
+	b.bind(end);
+}
+
+void do_statement::lower(bytecode_builder& b) const{
+	int body = b.new_label();
+	int cond = b.new_label();
+	int end = b.new_label();
+
+	b.bind(body);
+	b.enter_loop(end, cond);
+	b.add(_s);
+	b.leave_loop();
+	b.bind(cond);
+	b.branch(_e, true, body);
+	b.bind(end);
+}
+
+void if_statement::lower(bytecode_builder& b) const{
+	int end = b.new_label();
+
+	for(size_t i = 0; i < _es.size(); ++i){
+		int next = b.new_label();
+		b.branch(_es[i], false, next);
+		b.add(_ss[i]);
+		b.emit(vm_op::jump, end);
+		b.bind(next);
+	}
+	b.add(_ss.back());
+	b.bind(end);
+}
+
+void simple_if_statement::lower(bytecode_builder& b) const{
+	int end = b.new_label();
+
+	b.branch(_e, false, end);
+	b.add(_s);
+	b.bind(end);
+}
+
+void if_else_statement::lower(bytecode_builder& b) const{
+	int els = b.new_label();
+	int end = b.new_label();
+
+	b.branch(_e, false, els);
+	b.add(_s);
+	b.emit(vm_op::jump, end);
+	b.bind(els);
+	b.add(_else);
+	b.bind(end);
+}
+
+void switch_statement::lower(bytecode_builder& b) const{
+	std::vector<int> labels(_ss.size() + 1);
+	for(int& l: labels){
+		l = b.new_label();
+	}
+
+	auto label = [&labels](int32_t idx){
+		return labels[idx];
+	};
+
+	int mark = b.mark();
+	if(_strings){
+		string_switch cases = _string_cases;
+		cases.map_targets(label);
+		b.switch_jump(b.operand(_e), std::move(cases));
+	}else{
+		number_switch cases = _cases;
+		cases.map_targets(label);
+		b.switch_jump(b.operand(_e), std::move(cases));
+	}
+	b.release(mark);
+
+	b.enter_switch(labels.back());
+	for(size_t i = 0; i < _ss.size(); ++i){
+		b.bind(labels[i]);
+		b.add(_ss[i]);
+	}
+	b.leave_loop();
+	b.bind(labels.back());
+}
+
+void return_statement::lower(bytecode_builder& b) const{
+	b.ret(_e);
+}
+
+program_ptr compile_bytecode(const statement& body, size_t frame_base, bool tail_calls){
+	int max_depth;
+	{
+		bytecode_builder probe(frame_base, frame_base, tail_calls);
+		probe.add(body);
+		max_depth = probe.get_max_depth();
+	}
+
+	bytecode_builder builder(frame_base, max_depth, tail_calls);
+	builder.add(body);
+	builder.emit(vm_op::end);
+	return builder.finish();
+}
+
+}//donkey
@@ -0,0 +1,114 @@
+#ifndef __bytecode_compiler_hpp__
+#define __bytecode_compiler_hpp__
+
+#include "vm.hpp"
+
+namespace donkey{
+
+class bytecode_builder{
+	bytecode_builder(const bytecode_builder&) = delete;
+	void operator=(const bytecode_builder&) = delete;
+private:
+	struct jump_target{
+		int brk;
+		int brk_depth;
+		int cnt;
+		int cnt_depth;
+	};
+
+	std::shared_ptr<program> _p;
+	std::vector<int32_t> _labels;
+	std::vector<number_switch> _switches;
+	std::vector<string_switch> _string_switches;
+	std::vector<jump_target> _targets;
+	int _base;
+	int _depth;
+	int _max_depth;
+	int _temps_base;
+	int _temps;
+	int _max_temps;
+	bool _tail_calls;
+	bool _tail; //the next call_function returns from the program
+	int _locals_base; //where the locals of the function being inlined start
+	std::vector<const inline_function*> _inlining;
+	std::vector<std::string> _inlined;
+	std::vector<int32_t> _inlined_outer;
+	std::vector<int32_t> _inline_sites; //of the bodies being inlined, parallel to _inlining
+
+	void clear_to(int depth);
+	int arguments(const std::vector<expression_ptr>& params);
+	void inline_call(const inline_function& f, const std::vector<expression_ptr>& params, int dst);
+public:
+	bytecode_builder(int base, int temps_base, bool tail_calls);
+
+	int get_max_depth() const{
+		return _max_depth;
+	}
+
+	int constant(const variable& v);
+	int expression_index(const expression_ptr& e);
+	int statement_index(const statement& s);
+
+	int temp();
+	int temps(int cnt);
+
+	int mark() const{
+		return _temps;
+	}
+
+	void release(int mark){
+		_temps = mark;
+	}
+
+	int local(size_t idx) const{
+		return _locals_base + int(idx);
+	}
+
+	int target(int dst){
+		return dst >= 0 ? dst : temp();
+	}
+
+	int new_label();
+	void bind(int label);
+
+	void emit(vm_op op, int a = 0, int b = 0, int c = 0, int d = 0);
+
+	void value(const expression_ptr& e, int dst);
+	int operand(const expression_ptr& e);
+	//in order; a local read by e1 is copied first if e2 can have side effects
+	void operands(const expression_ptr& e1, const expression_ptr& e2, int& l, int& r);
+	void branch(const expression_ptr& e, bool when, int label);
+	void materialize(expression& e, int dst);
+
+	void unary(oper op, const expression_ptr& e, int dst);
+	void binary(oper op, const expression_ptr& e1, const expression_ptr& e2, int dst);
+	bool compare(oper op, const expression_ptr& e1, const expression_ptr& e2, bool when, int label);
+	bool increment(oper op, const expression_ptr& e, int dst);
+	bool compound_assignment(oper op, const expression_ptr& e1, const expression_ptr& e2, int dst);
+	void call(const expression_ptr& f, const std::vector<expression_ptr>& params, int dst);
+	void call_function(code_address f, const inline_function* inl, const std::vector<expression_ptr>& params, int dst);
+	bool tail_call(const expression_ptr& f, const std::vector<expression_ptr>& params);
+	void loop_step(const expression_ptr& step, const expression_ptr& cond, int body);
+	void ret(const expression_ptr& e);
+
+	void add(const statement& s);
+	int enter_block(int locals_count);
+	void leave_block(int depth);
+	void enter_loop(int brk, int cnt);
+	void enter_switch(int brk);
+	void leave_loop();
+	void break_jump();
+	void continue_jump();
+	//the targets of the cases are labels
+	void switch_jump(int r, number_switch&& cases);
+	void switch_jump(int r, string_switch&& cases);
+
+	program_ptr finish();
+};
+
+//tail calls are only for function bodies, whose caller runs them
+program_ptr compile_bytecode(const statement& body, size_t frame_base, bool tail_calls = false);
+
+}//donkey
+
+#endif /*__bytecode_compiler_hpp__*/
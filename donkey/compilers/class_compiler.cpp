@@ -2,6 +2,7 @@
 #include "compiler_helpers.hpp"
 #include "function_compiler.hpp"
 #include <unordered_set>
+#include <algorithm>
 
 using namespace std::placeholders;
 
@@ -206,7 +207,8 @@ void compile_class(scope& target, tokenizer& parser, bool is_public, bool is_fin
 		ctarget.define_constructor(std::bind(&default_constructor, bases, _1, _2, _3));
 	}
 	
-	if(!destructor_defined){
+	//without any destructor in the hierarchy the objects can be released without calling one
+	if(!destructor_defined && std::any_of(bases.begin(), bases.end(), [](vtable* vt){ return vt->has_destructor(); })){
 		ctarget.define_destructor(std::bind(&default_destructor, bases, _1, _2, _3));
 	}
 	
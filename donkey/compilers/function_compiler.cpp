@@ -4,6 +4,9 @@
 #include "donkey_function.hpp"
 #include "compiler_helpers.hpp"
 #include "expression_builder.hpp"
+#include "bytecode_compiler.hpp"
+#include "lazy_function.hpp"
+#include "module_cache.hpp"
 
 using namespace std::placeholders;
 
@@ -13,7 +16,8 @@ inline void compile_function_helper(std::string name, scope& target, tokenizer&
 	std::function<void(std::string, bool)> declare,
 	std::function<void(std::string, scope&, size_t)> define,
 	std::function<bool(std::string)> is_defined,
-	std::function<void(scope&, tokenizer&)> pre_function){
+	std::function<void(scope&, tokenizer&)> pre_function,
+	std::function<bool(std::string, const std::vector<std::string>&)> defer = nullptr){
 	
 	if(*parser == ";"){
 		declare(name, true);
@@ -54,6 +58,10 @@ inline void compile_function_helper(std::string name, scope& target, tokenizer&
 	
 	function_scope.add_variable("%RETVAL%", false);
 	
+	if(defer && defer(name, params)){
+		return;
+	}
+	
 	scope inner_scope(&function_scope);
 	
 	pre_function(inner_scope, parser);
@@ -62,9 +70,9 @@ inline void compile_function_helper(std::string name, scope& target, tokenizer&
 	
 	while(parser){
 		if(*parser == "}"){
-			++parser;
 			function_scope.add_statement(inner_scope.get_block());
 			define(name, function_scope, params.size());
+			++parser;
 			return;
 		}
 		compile_statement(inner_scope, parser);
@@ -72,14 +80,100 @@ inline void compile_function_helper(std::string name, scope& target, tokenizer&
 	syntax_error("'}' expected");
 }
 
+inline program_ptr compile_body(const std::string& name, scope& target, scope& function_scope, const statement& body, size_t params_size, bool tail_calls = false){
+	if(target.get_execution_mode() != execution_mode::bytecode){
+		return program_ptr();
+	}
+	function_scope.infer_local_types();
+	program_ptr ret = compile_bytecode(body, params_size + 1, tail_calls);
+	target.add_program(ret);
+	target.add_compiled(name, *ret);
+	return ret;
+}
+
 inline void declare_function(global_scope& target, std::string name, bool, bool is_public){
 	target.declare_function(name, is_public);
 }
 
-inline void define_function(global_scope& target, std::string name, scope& function_scope, size_t params_size){
+//the parser is still at the closing brace of the body
+inline void define_function(global_scope& target, const tokenizer& parser, std::string name, scope& function_scope, size_t params_size){
+	std::string function_name = target.get_module_name() + "::" + name;
+
+	statement body = function_scope.get_block();
+	program_ptr code = compile_body(function_name, target, function_scope, body, params_size, true);
+	
+	const return_statement* r = body.target<return_statement>();
+	if(r && code && code->is_inlinable()){
+		target.set_inline_function(name, r->get_expression(), params_size, function_name);
+	}else if(module_cache* cache = target.get_module_cache()){
+		//inlinable bodies are always compiled, as their callers compiled from the source need the tree
+		cache->add(name, params_size, parser.get_offset(), code);
+	}
+	
+	target.define_function(name, donkey_function(function_name, params_size, std::move(body), code));
+}
+
+//bodies found in the module cache are skipped, and run their cached code;
+//in lazy modules, the body is only skipped here, and compiled by the stub on the first call
+inline bool defer_function(global_scope& target, tokenizer& parser, std::string name, const std::vector<std::string>& params){
 	std::string function_name = target.get_module_name() + "::" + name;
+	
+	module_cache* cache = target.get_module_cache();
+	if(const module_cache::entry* e = cache ? cache->find(name, params.size()) : nullptr){
+		parser.seek_offset(e->end);
+		target.add_program(e->code);
+		target.add_compiled(function_name, *e->code);
+		target.define_function(name, donkey_function(function_name, params.size(), statement(), e->code));
+		return true;
+	}
+	
+	std::shared_ptr<lazy_module> m = target.get_lazy_module();
+	if(!m){
+		return false;
+	}
+	
+	if(*parser != "{"){
+		syntax_error("{ expected");
+	}
+	size_t body = parser.get_position() - m->source.data();
+	++parser;
+	
+	for(int depth = 1; depth != 0; ++parser){
+		if(!parser){
+			syntax_error("'}' expected");
+		}
+		if(*parser == "{"){
+			++depth;
+		}else if(*parser == "}"){
+			--depth;
+		}
+	}
+	
+	target.define_function(name, donkey_function(function_name, params.size(), std::make_shared<lazy_body>(lazy_body{m, name, params, body})));
+	return true;
+}
 
-	target.define_function(name, donkey_function(function_name, params_size, function_scope.get_block()));
+donkey_function compile_function_body(global_scope& target, tokenizer& parser, const std::string& name, const std::vector<std::string>& params){
+	scope function_scope(&target, true);
+	
+	for(const std::string& prm: params){
+		function_scope.add_variable(prm, false);
+	}
+	
+	function_scope.add_variable("%RETVAL%", false);
+	
+	scope inner_scope(&function_scope);
+	
+	while(*parser != "}"){
+		compile_statement(inner_scope, parser);
+	}
+	function_scope.add_statement(inner_scope.get_block());
+	
+	std::string function_name = target.get_module_name() + "::" + name;
+	
+	statement body = function_scope.get_block();
+	program_ptr code = compile_body(function_name, target, function_scope, body, params.size(), true);
+	return donkey_function(function_name, params.size(), std::move(body), code);
 }
 
 inline void declare_method(tokenizer&, std::string, bool forward){
@@ -91,7 +185,9 @@ inline void declare_method(tokenizer&, std::string, bool forward){
 inline void define_method(class_scope& target, std::string name, scope& function_scope, size_t params_size){
 	std::string method_name = target.get_current_class() + "::" + name;
 
-	target.define_method(name, donkey_method(method_name, params_size, function_scope.get_block()));
+	statement body = function_scope.get_block();
+	program_ptr code = compile_body(method_name, target, function_scope, body, params_size);
+	target.define_method(name, donkey_method(method_name, params_size, std::move(body), code));
 }
 
 inline void ignore_pre_function(scope&, tokenizer&){
@@ -112,9 +208,10 @@ void compile_function(scope& target, tokenizer& parser, bool is_public){
 		
 		compile_function_helper(name, target, parser,
 								std::bind(&declare_function, std::ref(gtarget), _1, _2, is_public),
-								std::bind(&define_function, std::ref(gtarget), _1, _2, _3),
+								std::bind(&define_function, std::ref(gtarget), std::cref(parser), _1, _2, _3),
 								std::bind(&global_scope::has_function, std::cref(gtarget), _1),
-								&ignore_pre_function);
+								&ignore_pre_function,
+								std::bind(&defer_function, std::ref(gtarget), std::ref(parser), _1, _2));
 		return;
 	}
 	if(target.is_class()){
@@ -142,7 +239,9 @@ inline void declare_constructor(tokenizer&, std::string, bool forward){
 
 inline void define_constructor(class_scope& target, std::string, scope& function_scope, size_t params_size){
 	std::string method_name = target.get_current_class() + "::" + target.get_constructor_name();
-	target.define_constructor(donkey_method(method_name, params_size, function_scope.get_block()));
+	statement body = function_scope.get_block();
+	program_ptr code = compile_body(method_name, target, function_scope, body, params_size);
+	target.define_constructor(donkey_method(method_name, params_size, std::move(body), code));
 }
 
 inline bool has_constructor(std::string){
@@ -232,7 +331,9 @@ inline void define_destructor(class_scope& target, tokenizer&, const std::vector
 	
 	std::string method_name = target.get_current_class() + "::" + target.get_destructor_name();
 	
-	target.define_destructor(donkey_method(method_name, params_size, function_scope.get_block()));
+	statement body = function_scope.get_block();
+	program_ptr code = compile_body(method_name, target, function_scope, body, params_size);
+	target.define_destructor(donkey_method(method_name, params_size, std::move(body), code));
 }
 
 inline bool has_destructor(std::string){
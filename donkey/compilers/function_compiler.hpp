@@ -12,6 +12,11 @@ void compile_constructor(class_scope& target, tokenizer& parser, const std::vect
 
 void compile_destructor(class_scope& target, tokenizer& parser, const std::vector<vtable*>& bases);
 
+class donkey_function;
+
+//the body of a function of a lazy module, from just past its opening brace
+donkey_function compile_function_body(global_scope& target, tokenizer& parser, const std::string& name, const std::vector<std::string>& params);
+
 
 }//donkey
 
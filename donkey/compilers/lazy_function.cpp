@@ -0,0 +1,34 @@
+#include "lazy_function.hpp"
+#include "function_compiler.hpp"
+#include "donkey_function.hpp"
+#include "errors.hpp"
+
+namespace donkey{
+
+void donkey_function::compile(runtime_context& ctx) const{
+	//held here, as the last function compiled lets go of the module source
+	std::shared_ptr<lazy_body> lazy = _lazy;
+	lazy_module& m = *lazy->m;
+
+	arena_scope nodes_scope(*m.nodes);
+
+	const char* begin = m.source.data();
+	tokenizer parser(m.file_name.c_str(), begin, begin + m.source.size());
+	parser.seek(begin + lazy->body);
+
+	try{
+		donkey_function f = compile_function_body(*m.scope, parser, lazy->name, lazy->params);
+		_body = std::move(f._body);
+		_code = std::move(f._code);
+	}catch(const exception_raw& e){
+		e.throw_formatted(parser.get_file_name(), parser.get_line_number() + 1);
+	}
+
+	_lazy.reset();
+
+	if(_code){
+		_code->link(ctx);
+	}
+}
+
+}//donkey
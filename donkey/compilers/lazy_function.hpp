@@ -0,0 +1,32 @@
+#ifndef __lazy_function_hpp__
+#define __lazy_function_hpp__
+
+#include <memory>
+#include <vector>
+#include <string>
+
+#include "arena.hpp"
+
+namespace donkey{
+
+class global_scope;
+
+//what the function bodies of a module loaded lazily are compiled from; kept alive by the functions not compiled yet
+struct lazy_module{
+	std::vector<char> source;
+	std::string file_name;
+	std::shared_ptr<global_scope> scope;
+	arena* nodes;
+};
+
+//a function body that was only skipped by brace matching
+struct lazy_body{
+	std::shared_ptr<lazy_module> m;
+	std::string name;
+	std::vector<std::string> params;
+	size_t body; //offset just past the opening brace
+};
+
+}//donkey
+
+#endif /*__lazy_function_hpp__*/
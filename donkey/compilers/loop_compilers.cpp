@@ -67,6 +67,11 @@ void compile_while(scope& target, tokenizer& parser){
 	parse(")", parser);
 	scope s(&target, false, false, true, true);
 	compile_statement(s, parser);
+	
+	bool cond;
+	if(get_constant_condition(e, cond) && !cond){
+		return;
+	}
 	target.add_statement(while_statement(e, s.get_block()));
 }
 
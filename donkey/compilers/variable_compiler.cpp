@@ -9,7 +9,7 @@ expression_ptr compile_variable(scope& target, tokenizer& parser, bool is_public
 		unexpected_error(*parser);
 	}
 
-	expression_ptr ret;
+	expression_ptr ret = nullptr;
 	
 	++parser;
 	
@@ -17,6 +17,7 @@ expression_ptr compile_variable(scope& target, tokenizer& parser, bool is_public
 		std::string name = parse_allowed_name(target, parser);
 		
 		expression_ptr e;
+		local_info* info = nullptr;
 		
 		if(target.is_global()){
 			e = build_global_variable_expression(
@@ -24,7 +25,8 @@ expression_ptr compile_variable(scope& target, tokenizer& parser, bool is_public
 				target.get_next_var_index()
 			);
 		}else{
-			e = build_local_variable_expression(target.get_next_var_index());
+			info = target.new_local();
+			e = build_local_variable_expression(target.get_next_var_index(), info);
 		}
 		
 		
@@ -36,11 +38,16 @@ expression_ptr compile_variable(scope& target, tokenizer& parser, bool is_public
 				build_expression(target, parser, false, true)
 			);
 			target.add_statement(expression_statement(ret));
+			
+			//only locals that never hold null can be numeric
+			if(info){
+				info->numeric = true;
+			}
 		}else{
-			ret.reset();
+			ret = nullptr;
 		}
 		
-		target.add_variable(name, is_public);
+		target.add_variable(name, is_public, info);
 		
 		if(*parser == ","){
 			++parser;
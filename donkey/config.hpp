@@ -8,11 +8,20 @@
 #	define noexcept
 #endif
 
+//packs variable into 8 bytes by storing everything but numbers inside NaNs
+//requires little endian and 48-bit pointers
+//#define DONKEY_NAN_BOXING
+
 namespace donkey{
 
 typedef double number;
 typedef int32_t integer;
 
+enum class execution_mode{
+	tree,
+	bytecode,
+};
+
 }//donkey
 
 #endif /*__config_hpp__*/
@@ -4,6 +4,7 @@
 #include "function.hpp"
 #include "native_converter.hpp"
 #include "donkey_callback.hpp"
+#include "call_stack.hpp"
 
 #include <tuple>
 #include <type_traits>
@@ -86,25 +87,21 @@ public:
 	}
 
 	variable operator()(runtime_context& ctx, size_t sz){
-		try{
-			size_t missing = sizeof...(Args) > sz ? sizeof...(Args) - sz : 0;
-		
-			stack_pusher pusher(ctx, missing);
-			if(missing){
-				if(missing > dflts_size){
-					runtime_error("not enough function parameters provided");
-					return variable();
-				}
-				
-				detail::dflt_unpacker<D, dflts_size != 0, 0>::unpack(dflts_size - missing, _d, ctx, pusher);
-				sz = sizeof...(Args);
+		call_stack_frame frame(_name);
+		size_t missing = sizeof...(Args) > sz ? sizeof...(Args) - sz : 0;
+	
+		stack_pusher pusher(ctx, missing);
+		if(missing){
+			if(missing > dflts_size){
+				runtime_error("not enough function parameters provided");
+				return variable();
 			}
-		
-			return detail::caller<F, R, std::tuple<>, std::tuple<Args...> >::call(sz-1, _f, ctx);
-		}catch(const runtime_exception& e){
-			e.add_stack_trace(_name);
+			
+			detail::dflt_unpacker<D, dflts_size != 0, 0>::unpack(dflts_size - missing, _d, ctx, pusher);
+			sz = sizeof...(Args);
 		}
-		return variable();
+	
+		return detail::caller<F, R, std::tuple<>, std::tuple<Args...> >::call(sz-1, _f, ctx);
 	}
 };
 
@@ -127,25 +124,21 @@ public:
 	}
 
 	variable operator()(const variable& that, runtime_context& ctx, size_t sz){
-		try{
-			size_t missing = sizeof...(Args) > sz ? sizeof...(Args) - sz : 0;
-			stack_pusher pusher(ctx, missing);
-			if(missing){
-				if(missing > dflts_size){
-					runtime_error("not enough function parameters provided");
-					return variable();
-				}
-				
-				detail::dflt_unpacker<D, dflts_size != 0, 0>::unpack(dflts_size - missing, _d, ctx, pusher);
-				sz = sizeof...(Args);
+		call_stack_frame frame(_name);
+		size_t missing = sizeof...(Args) > sz ? sizeof...(Args) - sz : 0;
+		stack_pusher pusher(ctx, missing);
+		if(missing){
+			if(missing > dflts_size){
+				runtime_error("not enough function parameters provided");
+				return variable();
 			}
 			
-		
-			return detail::caller<F, R, std::tuple<T>, std::tuple<Args...> >::call(sz-1, _f, ctx, detail::this_converter<T>::to_native(that, ctx));
-		}catch(const runtime_exception& e){
-			e.add_stack_trace(_name);
+			detail::dflt_unpacker<D, dflts_size != 0, 0>::unpack(dflts_size - missing, _d, ctx, pusher);
+			sz = sizeof...(Args);
 		}
-		return variable();
+		
+	
+		return detail::caller<F, R, std::tuple<T>, std::tuple<Args...> >::call(sz-1, _f, ctx, detail::this_converter<T>::to_native(that, ctx));
 	}
 };
 
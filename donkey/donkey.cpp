@@ -2,9 +2,16 @@
 #include "tokenizer.hpp"
 #include "scope.hpp"
 #include "compilers/statement_compiler.hpp"
+#include "compilers/bytecode_compiler.hpp"
+#include "compilers/lazy_function.hpp"
+#include "module_cache.hpp"
 #include "module.hpp"
 #include "compiler.hpp"
 #include <unordered_map>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include "module_bundle.hpp"
 
 namespace donkey{
@@ -39,6 +46,22 @@ static bool get_file(const std::string fname, std::vector<char>& v){
 	return true;
 }
 
+static bool put_file(const std::string fname, const std::vector<char>& v){
+#ifdef _MSC_VER
+	FILE* fp = nullptr;
+	fopen_s(&fp, fname.c_str(), "wb");
+#else
+	FILE* fp = fopen(fname.c_str(), "wb");
+#endif
+
+	if(!fp){
+		return false;
+	}
+
+	bool written = fwrite(v.data(), 1, v.size(), fp) == v.size();
+	return fclose(fp) == 0 && written;
+}
+
 
 class compiler::priv{
 private:
@@ -48,74 +71,387 @@ private:
 	
 	std::unordered_map<std::string, module_loader> _loaders;
 	
-	void load_donkey_module(tokenizer& parser, std::string module_name){
-		size_t idx = _modules.reserve_module(module_name);
+	execution_mode _mode;
+	
+	bool _lazy;
+	
+	bool _cache;
+	
+	size_t _threads;
+	
+	//of the modules loaded, for the caches of the modules importing them
+	std::unordered_map<std::string, uint64_t> _keys;
+	
+	std::string cache_file_name(const std::string& module_name) const{
+		return _root + module_name + ".dkyc";
+	}
+	
+	//caches are only saved by modules compiled in full, but lazy modules read them
+	std::shared_ptr<module_cache> open_cache(const std::string& module_name, uint64_t key, bool lazy){
+		std::shared_ptr<module_cache> cache(new module_cache(key));
+		std::vector<char> data;
+		if(get_file(cache_file_name(module_name), data)){
+			cache->load(data);
+		}
+		if(lazy && !cache->is_loaded()){
+			cache.reset();
+		}
+		return cache;
+	}
+	
+	struct module_job;
+	
+	struct import_line{
+		std::string name;
+		bool use;
+		size_t line;
+		module_job* job; //nullptr for modules loaded before
+	};
+	
+	//a module of the load_module call in progress: its imports are read first, then it is compiled
+	//on any thread once they are compiled, and added to the bundle on this one once they are added
+	struct module_job{
+		std::string name;
+		size_t idx;
+		std::vector<char> local;
+		std::shared_ptr<lazy_module> lazy; //keeps the source when there is one
+		std::unique_ptr<tokenizer> parser; //just past the imports
+		std::vector<import_line> imports;
+		bool imports_read;
+		module_ptr m; //native modules have it from the start
+		std::shared_ptr<module_cache> cache;
+		uint64_t key;
+		std::string error;
+		bool started;
+		bool compiled;
+		bool finished;
 		
+		explicit module_job(const std::string& name):
+			name(name),
+			idx(0),
+			imports_read(false),
+			key(0),
+			started(false),
+			compiled(false),
+			finished(false){
+		}
 		
-		global_scope target(_modules, std::move(module_name), idx);
+		std::vector<char>& source(){
+			return lazy ? lazy->source : local;
+		}
 		
-		while(*parser == "import" || *parser == "using"){
-			bool use = (*parser == "using");
-			++parser;
-			std::string import_name = *parser;
-			
-			++parser;
+		//skipped when an import failed, which is reported by the module importing it
+		bool failed() const{
+			return !error.empty() || (compiled && !m);
+		}
+	};
+	
+	//the modules of the load_module call in progress, imports first
+	std::unordered_map<std::string, std::unique_ptr<module_job> > _jobs;
+	std::vector<module_job*> _order;
+	
+	module_job& new_job(const std::string& name){
+		module_job* ret = new module_job(name);
+		_jobs[name].reset(ret);
+		return *ret;
+	}
+	
+	//reserves the indices in the order in which the modules would be loaded one at a time;
+	//nullptr if there is no such module
+	module_job* read_imports(const std::string& module_name){
+		auto it = _loaders.find(module_name);
+		if(it != _loaders.end()){
+			module_job& job = new_job(module_name);
+			job.idx = _modules.reserve_module(module_name);
+			job.m = it->second(job.idx);
+			if(_cache){
+				job.key = module_cache::module_key(module_name, job.idx, *job.m);
+			}
+			job.imports_read = true;
+			job.compiled = true;
+			_order.push_back(&job);
+			return &job;
+		}
+		
+		std::shared_ptr<lazy_module> lazy;
+		if(_lazy){
+			lazy.reset(new lazy_module{std::vector<char>(), module_name, nullptr, nullptr});
+		}
+		
+		std::vector<char> v;
+		if(!get_file(_root + module_name + ".dky", v)){
+			return nullptr;
+		}
+		
+		module_job& job = new_job(module_name);
+		job.idx = _modules.reserve_module(module_name);
+		job.lazy = lazy;
+		job.source().swap(v);
+		
+		try{
+			try{
+				std::vector<char>& source = job.source();
+				job.parser.reset(new tokenizer(module_name.c_str(), &source[0], &source[0] + source.size()));
+				tokenizer& parser = *job.parser;
+				
+				while(*parser == "import" || *parser == "using"){
+					bool use = (*parser == "using");
+					++parser;
+					std::string import_name = *parser;
+					
+					++parser;
+					
+					import_line line{import_name, use, size_t(parser.get_line_number() + 1), nullptr};
+					
+					auto jit = _jobs.find(import_name);
+					if(jit != _jobs.end()){
+						if(!jit->second->imports_read){
+							semantic_error("circular import detected for " + import_name);
+						}
+						line.job = jit->second.get();
+					}else if(!_modules.get_module(import_name)){
+						if(_modules.module_in_progress(import_name)){
+							semantic_error("circular import detected for " + import_name);
+						}
+						line.job = read_imports(import_name);
+						if(!line.job){
+							semantic_error("unknown module " + import_name);
+						}
+					}
+					
+					job.imports.push_back(line);
+					
+					//the rest would not be read if the modules were loaded one at a time
+					if(line.job && !line.job->error.empty()){
+						break;
+					}
+					
+					parse(";", parser);
+				}
+			}catch(const exception_raw& e){
+				e.throw_formatted(module_name, job.parser ? job.parser->get_line_number() + 1 : 1);
+			}
+		}catch(const exception& e){
+			job.error = e.what();
+		}
+		
+		job.imports_read = true;
+		_order.push_back(&job);
+		return &job;
+	}
+	
+	//runs on any thread, once the imports are compiled; touches nothing but the job and the modules loaded before
+	void compile(module_job& job){
+		if(!job.error.empty()){
+			return;
+		}
+		for(const import_line& i: job.imports){
+			if(i.job && i.job->failed()){
+				return;
+			}
+		}
+		
+		const std::string& module_name = job.name;
+		tokenizer& parser = *job.parser;
+		
+		std::unique_ptr<arena> nodes(new arena());
+		arena_scope nodes_scope(*nodes);
+		
+		std::shared_ptr<global_scope> target_ptr(new global_scope(_modules, std::string(module_name), job.idx, _mode));
+		global_scope& target = *target_ptr;
+		
+		if(job.lazy){
+			job.lazy->scope = target_ptr;
+			job.lazy->nodes = nodes.get();
+			target.set_lazy_module(job.lazy);
+		}
+		
+		try{
+			std::vector<uint64_t> imports;
 			
-			module_ptr m = _modules.get_module(import_name);
+			for(const import_line& i: job.imports){
+				try{
+					module_ptr m = i.job ? i.job->m : _modules.get_module(i.name);
+					
+					target.import(i.name, *m);
+					
+					if(i.job){
+						imports.push_back(i.job->key);
+					}else{
+						auto kit = _keys.find(i.name);
+						imports.push_back(kit != _keys.end() ? kit->second : 0);
+					}
+					
+					if(i.use){
+						target.add_using(target.get_identifier(i.name));
+					}
+				}catch(const exception_raw& e){
+					e.throw_formatted(parser.get_file_name(), i.line);
+				}
+			}
 			
-			if(!m){	
-				if(_modules.module_in_progress(import_name)){
-					semantic_error("circular import detected for " + import_name);
+			try{
+				if(_cache && _mode == execution_mode::bytecode){
+					job.key = module_cache::module_key(module_name, job.idx, job.source(), imports);
+					job.cache = open_cache(module_name, job.key, bool(job.lazy));
+					target.set_module_cache(job.cache);
+				}
+				
+				for(; parser;){
+					compile_statement(target, parser);
 				}
-				if(!load_module(import_name.c_str())){
-					semantic_error("unknown module " + import_name);
+				
+				std::string not_defined = target.get_undefined_function();
+				if(not_defined != ""){
+					semantic_error(not_defined + " is not defined");
 				}
-				m = _modules.get_module(import_name);
+				
+				statement body = target.get_block();
+				program_ptr code;
+				if(_mode == execution_mode::bytecode){
+					target.infer_local_types();
+					code = compile_bytecode(body, 0);
+					target.add_compiled(module_name + "::(global)", *code);
+				}
+				
+				job.m.reset(new module(
+					std::move(body),
+					module_name,
+					job.idx,
+					target.get_number_of_variables(),
+					target.get_functions(),
+					target.get_vtables(),
+					target.get_public_functions(),
+					target.get_public_vars(),
+					target.get_public_constants(),
+					code,
+					std::move(nodes),
+					target.get_programs(),
+					target.get_inlined_calls(),
+					target.get_counted_loops()
+				));
+			}catch(const exception_raw& e){
+				e.throw_formatted(parser.get_file_name(), parser.get_line_number() + 1);
 			}
-			
-			target.import(import_name, *m);
-			
-			if(use){
-				target.add_using(target.get_identifier(import_name));
+		}catch(const exception& e){
+			job.error = e.what();
+		}
+	}
+	
+	static std::string formatted(const exception_raw& e, const std::string& file, size_t line){
+		try{
+			e.throw_formatted(file, line);
+		}catch(const exception& fe){
+			return fe.what();
+		}
+		return e.what();
+	}
+	
+	bool ready(const module_job& job) const{
+		for(const import_line& i: job.imports){
+			if(i.job && !i.job->compiled){
+				return false;
 			}
-			
-			parse(";", parser);
 		}
+		return true;
+	}
+	
+	//each thread takes the first module whose imports are compiled
+	void compile_all(){
+		std::mutex mutex;
+		std::condition_variable changed;
 		
-		for(; parser;){
-			compile_statement(target, parser);
-		}
+		auto work = [&](){
+			std::unique_lock<std::mutex> lock(mutex);
+			for(;;){
+				module_job* next = nullptr;
+				bool pending = false;
+				for(module_job* job: _order){
+					if(!job->started && !job->compiled){
+						pending = true;
+						if(ready(*job)){
+							next = job;
+							break;
+						}
+					}
+				}
+				if(!pending){
+					return;
+				}
+				if(!next){
+					changed.wait(lock);
+					continue;
+				}
+				
+				next->started = true;
+				lock.unlock();
+				compile(*next);
+				lock.lock();
+				next->compiled = true;
+				changed.notify_all();
+			}
+		};
 		
-		std::string not_defined = target.get_undefined_function();
-		if(not_defined != ""){
-			semantic_error(not_defined + " is not defined");
+		size_t threads = std::min<size_t>(_threads, _order.size());
+		std::vector<std::thread> pool;
+		for(size_t i = 1; i < threads; ++i){
+			pool.emplace_back(work);
+		}
+		work();
+		for(std::thread& t: pool){
+			t.join();
 		}
-		
-		_modules.add_module(module_name, module_ptr(new module(
-			target.get_block(),
-			module_name,
-			idx,
-			target.get_number_of_variables(),
-			target.get_functions(),
-			target.get_vtables(),
-			target.get_public_functions(),
-			target.get_public_vars(),
-			target.get_public_constants()
-		)));
 	}
 	
-	void load_native_module(const std::string& name, const module_loader& loader){
-		size_t idx = _modules.reserve_module(name);
+	//in the order in which the modules would be loaded one at a time, and with the same errors
+	bool finish(module_job& job){
+		if(job.finished){
+			return !job.failed();
+		}
+		job.finished = true;
+		
+		for(const import_line& i: job.imports){
+			if(i.job && !finish(*i.job)){
+				try{
+					semantic_error("unknown module " + i.name);
+				}catch(const exception_raw& e){
+					job.error = formatted(e, job.name, i.line);
+				}
+				break;
+			}
+		}
 		
-		module_ptr module = loader(idx);
+		if(job.error.empty()){
+			try{
+				_modules.add_module(job.name, job.m);
+			}catch(const exception& e){
+				job.error = e.what();
+			}
+		}
 		
-		_modules.add_module(name, module);
+		if(!job.error.empty()){
+			_modules.unload_from(job.idx);
+			fprintf(stderr, "%s\n", job.error.c_str());
+			return false;
+		}
+		
+		if(_cache){
+			_keys[job.name] = job.key;
+		}
+		if(job.cache && !job.cache->is_loaded()){
+			put_file(cache_file_name(job.name), job.cache->save());
+		}
+		return true;
 	}
 	
 public:
-	priv(const char* root, size_t stack_size):
+	priv(const char* root, size_t stack_size, execution_mode mode, bool lazy, bool cache, size_t threads):
 		_root(root),
-		_modules(stack_size){
+		_modules(stack_size),
+		_mode(mode),
+		_lazy(lazy),
+		_cache(cache),
+		_threads(threads ? threads : 1){
 
 		if(!_root.empty() && _root.back() != '/'){
 			_root += '/';
@@ -128,42 +464,31 @@ public:
 	
 
 	bool load_module(const char* module_name){
-		auto it = _loaders.find(module_name);
-		
-		if(it != _loaders.end()){
-			load_native_module(it->first, it->second);
-			return true;
+		module_job* job = read_imports(module_name);
+		bool ret = false;
+		if(job){
+			compile_all();
+			ret = finish(*job);
 		}
-	
-		
-		std::vector<char> v;
-		if(!get_file(_root + module_name + ".dky", v)){
-			return false;
-		}
-		
-		std::unique_ptr<tokenizer> parser;
-		
-		size_t idx = _modules.get_modules_count();
 		
-		try{
-			try{
-				parser.reset(new tokenizer(module_name, &v[0], &v[0] + v.size()));
-				load_donkey_module(*parser, module_name);
-				return true;
-			}catch(const exception_raw& e){
-				e.throw_formatted(parser->get_file_name(), parser->get_line_number() + 1);
-			}
-		}catch(const exception& e){
-			_modules.unload_from(idx);
-			fprintf(stderr, "%s\n", e.what());
-		}
-		return false;
+		_order.clear();
+		_jobs.clear();
+		return ret;
+	}
+	
+	std::vector<std::string> get_inlined_calls(const char* module_name){
+		module_ptr m = _modules.get_module(module_name);
+		return m ? m->get_inlined_calls() : std::vector<std::string>();
 	}
 	
+	size_t get_counted_loops(const char* module_name){
+		module_ptr m = _modules.get_module(module_name);
+		return m ? m->get_counted_loops() : 0;
+	}
 };
 
-compiler::compiler(const char* root, size_t stack_size):
-	_private(new priv(root, stack_size)){
+compiler::compiler(const char* root, size_t stack_size, execution_mode mode, bool lazy, bool cache, size_t threads):
+	_private(new priv(root, stack_size, mode, lazy, cache, threads)){
 }
 
 void compiler::add_module_loader(const char* module_name, const module_loader& loader){
@@ -174,6 +499,18 @@ bool compiler::load_module(const char* module_name){
 	return _private->load_module(module_name);
 }
 
+std::vector<std::string> compiler::get_inlined_calls(const char* module_name) const{
+	return _private->get_inlined_calls(module_name);
+}
+
+size_t compiler::get_counted_loops(const char* module_name) const{
+	return _private->get_counted_loops(module_name);
+}
+
+member_cache_stats compiler::get_member_cache_stats() const{
+	return donkey::get_member_cache_stats();
+}
+
 
 compiler::~compiler(){
 	delete _private;
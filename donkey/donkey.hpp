@@ -3,6 +3,10 @@
 
 #include <memory>
 #include <functional>
+#include <vector>
+#include <string>
+
+#include "config.hpp"
 
 namespace donkey{
 
@@ -13,6 +17,12 @@ typedef std::shared_ptr<module> module_ptr;
 
 typedef std::function<module_ptr(size_t)> module_loader;
 
+struct member_cache_stats{
+	size_t hits; //found in the call site cache
+	size_t global_hits; //found in the megamorphic cache
+	size_t misses; //looked up in the vtable
+};
+
 class compiler{
 	compiler(const compiler&) = delete;
 	void operator=(const compiler&) = delete;
@@ -20,11 +30,24 @@ private:
 	class priv;
 	priv* _private;
 public:
-	compiler(const char* root, size_t stack_size = 1024);
+	//lazy compilers skip the function bodies of donkey modules, and compile each on its first call;
+	//caching compilers keep the function bodies compiled to bytecode in <module>.dkyc next to the source,
+	//and skip them while the source, its imports and the interpreter are unchanged;
+	//up to threads donkey modules whose imports are compiled are compiled at once, and still loaded in import order
+	compiler(const char* root, size_t stack_size = 1024, execution_mode mode = execution_mode::bytecode, bool lazy = false, bool cache = false, size_t threads = 1);
 	
 	void add_module_loader(const char* module_name, const module_loader& loader);
 	
 	bool load_module(const char* module_name);
+	
+	//"caller: callee" for each call site of a loaded module where the callee was inlined
+	std::vector<std::string> get_inlined_calls(const char* module_name) const;
+	
+	//for loops of a loaded module whose step and condition became one instruction
+	size_t get_counted_loops(const char* module_name) const;
+	
+	//member lookups by name made by code running on the calling thread
+	member_cache_stats get_member_cache_stats() const;
 	~compiler();
 };
 
@@ -3,43 +3,113 @@
 
 #include "runtime_context.hpp"
 #include "statements.hpp"
+#include "vm.hpp"
+#include "collector.hpp"
+#include "call_stack.hpp"
 
 namespace donkey{
 
+struct lazy_body; //compilers/lazy_function.hpp
+
 class donkey_function{
 private:
 	size_t _params_count;
-	statement _body;
+	//filled in by the first call when the function is lazy
+	mutable statement _body;
+	mutable program_ptr _code;
 	std::string _name;
+	mutable std::shared_ptr<lazy_body> _lazy;
+	
+	void compile(runtime_context& ctx) const; //compilers/lazy_function.cpp
 public:
 	donkey_function(const donkey_function& orig):
 		_params_count(orig._params_count),
 		_body(orig._body),
-		_name(orig._name){
+		_code(orig._code),
+		_name(orig._name),
+		_lazy(orig._lazy){
 	}
 
 	donkey_function(donkey_function&& orig):
 		_params_count(orig._params_count),
 		_body(std::move(orig._body)),
-		_name(std::move(orig._name)){
+		_code(std::move(orig._code)),
+		_name(std::move(orig._name)),
+		_lazy(std::move(orig._lazy)){
 	}
 	
-	donkey_function(const std::string& name, size_t params_count, statement&& body):
+	donkey_function(const std::string& name, size_t params_count, statement&& body, program_ptr code):
 		_params_count(params_count),
 		_body(std::move(body)),
+		_code(code),
 		_name(name){
 	}
+	
+	//the body is compiled on the first call
+	donkey_function(const std::string& name, size_t params_count, const std::shared_ptr<lazy_body>& lazy):
+		_params_count(params_count),
+		_name(name),
+		_lazy(lazy){
+	}
+	
+	const program_ptr& get_code() const{
+		return _code;
+	}
+	
 	variable operator()(runtime_context& ctx, size_t params_count) const{
-		try{
+		if(_lazy){
+			compile(ctx);
+		}
+		
+		collection_safepoint();
+		call_stack_frame frame(_name);
+		function_stack_manipulator _(ctx, _params_count, params_count);
+		
+		if(_code){
+			tail_params_saver saver(ctx);
+			//tail calls run here, one at a time, above this function's params
+			for(const donkey_function* f = _code->run(ctx); f; f = f->tail_call(ctx)){
+			}
+		}else{
+			_body(ctx);
+		}
+		
+		return ctx.top();
+	}
+	
+	//runs with ctx.tail_params(); the result goes to the retval of the function that made the first tail call
+	const donkey_function* tail_call(runtime_context& ctx) const{
+		if(_lazy){
+			compile(ctx);
+		}
+		
+		std::vector<variable>& params = ctx.tail_params();
+		size_t params_count = params.size();
+		
+		stack_pusher pusher(ctx, params_count);
+		for(variable& v: params){
+			pusher.push(std::move(v));
+		}
+		params.clear();
+		
+		collection_safepoint();
+		variable ret;
+		{
+			call_stack_frame frame(_name);
 			function_stack_manipulator _(ctx, _params_count, params_count);
 			
-			_body(ctx);
+			if(_code){
+				if(const donkey_function* f = _code->run(ctx)){
+					return f;
+				}
+			}else{
+				_body(ctx);
+			}
 			
-			return ctx.top();
-		}catch(const runtime_exception& e){
-			e.add_stack_trace(_name);
+			ret = std::move(ctx.top());
 		}
-		return variable();
+		ctx.set_retval(std::move(ret));
+		return nullptr;
 	}
 };
 
@@ -48,36 +118,41 @@ class donkey_method{
 private:
 	size_t _params_count;
 	statement _body;
+	program_ptr _code;
 	std::string _name;
 public:
 	donkey_method(const donkey_method& orig):
 		_params_count(orig._params_count),
 		_body(orig._body),
+		_code(orig._code),
 		_name(orig._name){
 	}
 
 	donkey_method(donkey_method&& orig):
 		_params_count(orig._params_count),
 		_body(std::move(orig._body)),
+		_code(std::move(orig._code)),
 		_name(orig._name){
 	}
 	
-	donkey_method(const std::string& name, size_t params_count, statement&& body):
+	donkey_method(const std::string& name, size_t params_count, statement&& body, program_ptr code):
 		_params_count(params_count),
 		_body(std::move(body)),
+		_code(code),
 		_name(name){
 	}
 	variable operator()(const variable& that, runtime_context& ctx, size_t params_count) const{
-		try{
-			function_stack_manipulator _(ctx, _params_count, params_count, &that);
-			
+		collection_safepoint();
+		call_stack_frame frame(_name);
+		function_stack_manipulator _(ctx, _params_count, params_count, &that);
+		
+		if(_code){
+			_code->run(ctx);
+		}else{
 			_body(ctx);
-			
-			return ctx.top();
-		}catch(const runtime_exception& e){
-			e.add_stack_trace(_name);
 		}
-		return variable();
+		
+		return ctx.top();
 	}
 };
 
@@ -3,52 +3,42 @@
 #include "vtable.hpp"
 #include "runtime_context.hpp"
 
-#include <vector>
-
 
 namespace donkey{
 
-struct donkey_object::data{
-	std::vector<variable> fields;
-	vtable* vt;
-	runtime_context* ctx;
-	
-	data(vtable* vt, runtime_context* ctx):
-		fields(vt->get_fields_size()),
-		vt(vt),
-		ctx(ctx){
-	}
-};
+static_assert(sizeof(donkey_object) % alignof(variable) == 0, "misaligned donkey_object fields");
 
-donkey_object::donkey_object(vtable* vt, runtime_context* ctx):
-	_data(new data(vt, ctx)){
-	if(!_data){
-		runtime_error("out of memory");
-	}
+size_t donkey_object::get_allocation_size(vtable* vt){
+	return sizeof(donkey_object) + vt->get_fields_size() * sizeof(variable);
 }
 
-vtable* donkey_object::get_vtable(){
-	return _data->vt;
-}
-
-variable& donkey_object::get_field(size_t i){
-	return _data->fields[i];
+donkey_object::donkey_object(vtable* vt, runtime_context* ctx):
+	_vt(vt),
+	_ctx(ctx),
+	_fields_size(vt->get_fields_size()){
+	variable* fields = &get_field(0);
+	for(size_t i = 0; i < _fields_size; ++i){
+		new(fields + i) variable();
+	}
 }
 
 const std::string& donkey_object::get_type_name() const{
-	return _data->vt->get_name();
+	return _vt->get_name();
 }
 
 const std::string& donkey_object::get_module_name() const{
-	return _data->vt->get_module_name();
+	return _vt->get_module_name();
 }
 
 donkey_object::~donkey_object(){
-	delete _data;
+	variable* fields = &get_field(0);
+	for(size_t i = 0; i < _fields_size; ++i){
+		fields[i].~variable();
+	}
 }
 
 void donkey_object::dispose(const variable& v){
-	_data->vt->call_destructor(v, *_data->ctx);
+	_vt->call_destructor(v, *_ctx);
 }
 
 
@@ -2,6 +2,7 @@
 #define __donkey_object_hpp__
 
 #include <string>
+#include <cstddef>
 
 namespace donkey{
 
@@ -11,16 +12,24 @@ class runtime_context;
 
 class vtable;
 
+//fields are stored inline, right after the object
 class donkey_object{
-	struct data;
 	donkey_object(const donkey_object&) = delete;
 	void operator=(const donkey_object&) = delete;
 private:
-	data* _data;
+	vtable* _vt;
+	runtime_context* _ctx;
+	size_t _fields_size;
 public:
+	static size_t get_allocation_size(vtable* vt);
 	donkey_object(vtable* vt, runtime_context* ctx);
-	vtable* get_vtable();
-	variable& get_field(size_t i);
+	vtable* get_vtable(){
+		return _vt;
+	}
+	variable& get_field(size_t i); //variables.hpp
+	size_t get_fields_size() const{
+		return _fields_size;
+	}
 	const std::string& get_type_name() const;
 	const std::string& get_module_name() const;
 	void dispose(const variable& v);
@@ -1,4 +1,5 @@
 #include "errors.hpp"
+#include "call_stack.hpp"
 
 namespace donkey{
 
@@ -42,12 +43,6 @@ runtime_exception::runtime_exception(std::string what):
 	exception(std::move(what)){
 }
 
-void runtime_exception::add_stack_trace(std::string trace) const{
-	std::string str = what_str();
-	str += "\n\tat " + std::move(trace);
-	throw runtime_exception(std::move(str));
-}
-
 static void error(std::string error_type, std::string message){
 	throw exception_raw(std::string(error_type) + " in %FILE%:%LINE%: " + message);
 }
@@ -65,14 +60,10 @@ void semantic_error(std::string message){
 }
 
 void runtime_error(std::string message){
-	throw runtime_exception("Runtime error: " + std::move(message));
+	throw runtime_exception("Runtime error: " + std::move(message) + current_call_stack().trace());
 }
 
 
-void add_stack_trace(const runtime_exception& ex, std::string trace){
-	ex.add_stack_trace(std::move(trace));
-}
-
 void throw_formatted(const exception_raw& ex, std::string filename, size_t line_number){
 	ex.throw_formatted(filename, line_number);
 }
@@ -31,8 +31,6 @@ public:
 class runtime_exception: public exception{
 public:
 	runtime_exception(std::string what);
-	
-	void add_stack_trace(std::string trace) const;
 };
 
 void parse_error(std::string message);
@@ -418,9 +418,15 @@ static expression_ptr identifier_to_expression(identifier_ptr id){
 				);
 			}
 		case identifier_type::local_variable:
-			return build_local_variable_expression(static_cast<local_variable_identifier&>(*id).get_index());
+			return build_local_variable_expression(
+				static_cast<local_variable_identifier&>(*id).get_index(),
+				static_cast<local_variable_identifier&>(*id).get_info()
+			);
 		case identifier_type::function:
-			return build_const_function_expression(static_cast<function_identifier&>(*id).get_function());
+			return build_const_function_expression(
+				static_cast<function_identifier&>(*id).get_function(),
+				static_cast<function_identifier&>(*id).get_inline()
+			);
 		case identifier_type::number:
 			return build_const_number_expression(static_cast<number_constant_identifier&>(*id).get_number());
 		case identifier_type::string:
@@ -431,7 +437,7 @@ static expression_ptr identifier_to_expression(identifier_ptr id){
 		case identifier_type::module:
 			semantic_error("unexpected module " + id->get_name());
 		case identifier_type::method:
-			return build_free_method_expression(static_cast<method_identifier&>(*id).get_classname(), static_cast<method_identifier&>(*id).get_method());
+			return build_free_method_expression(static_cast<method_identifier&>(*id).get_class(), static_cast<method_identifier&>(*id).get_method());
 		case identifier_type::field:
 			semantic_error("unexpected field" + id->get_name());
 	}
@@ -493,7 +499,10 @@ static void fetch_params(part_ptr head, const identifier_lookup& lookup, std::ve
 					}
 					break;
 				case identifier_type::local_variable:
-					e =  build_local_variable_expression(static_cast<local_variable_identifier&>(*id).get_index());
+					e =  build_local_variable_expression(
+						static_cast<local_variable_identifier&>(*id).get_index(),
+						static_cast<local_variable_identifier&>(*id).get_info()
+					);
 					break;
 				default:
 					semantic_error("only variables can be passed by reference");
@@ -537,9 +546,9 @@ static identifier_ptr tree_to_identifier(part_ptr tree, const identifier_lookup&
 						class_identifier& c = static_cast<class_identifier&>(*l);
 						std::string r = tree->first_child->next_sibling->str;
 						if(c.get_vtable()->has_method(r)){
-							return identifier_ptr(new method_identifier(r, *(c.get_vtable()->get_method(r)), c.get_vtable()->get_full_name()));
+							return identifier_ptr(new method_identifier(r, *(c.get_vtable()->get_method(r)), c.get_vtable()));
 						}else if(c.get_vtable()->has_field(r)){
-							return identifier_ptr(new field_identifier(r, c.get_vtable()->get_field_index(r), c.get_vtable()->get_full_name()));
+							return identifier_ptr(new field_identifier(r, c.get_vtable()->get_field_index(r), c.get_vtable()));
 						}else{
 							semantic_error("class " + c.get_vtable()->get_full_name() + " doesn't have member " + r);
 							return identifier_ptr();
@@ -630,18 +639,18 @@ static expression_ptr tree_to_expression(part_ptr tree, const identifier_lookup&
 					vtable* vt = lookup.get_current_vtable();
 					std::string member = tree->first_child->next_sibling->str;
 					if(vt->has_method(member)){
-						return build_method_expression(that, lookup.get_current_class(), *vt->get_method(member));
+						return build_method_expression(that, vt, *vt->get_method(member));
 					}else if(vt->has_field(member)){
-						return build_field_expression(that, lookup.get_current_class(), vt->get_field_index(member));
+						return build_field_expression(that, vt, vt->get_field_index(member));
 					}else{
 						semantic_error(lookup.get_current_class() + " doesn't have member " + member);
 					}
 				}else if(tree->first_child->next_sibling->op == oper::scope){
 					identifier_ptr id = tree_to_identifier(tree->first_child->next_sibling, lookup);
 					if(id->get_type() == identifier_type::method){
-						return build_method_expression(that, static_cast<method_identifier&>(*id).get_classname(), static_cast<method_identifier&>(*id).get_method());
+						return build_method_expression(that, static_cast<method_identifier&>(*id).get_class(), static_cast<method_identifier&>(*id).get_method());
 					}else if(id->get_type() == identifier_type::field){
-						return build_field_expression(that, static_cast<field_identifier&>(*id).get_classname(), static_cast<field_identifier&>(*id).get_field());
+						return build_field_expression(that, static_cast<field_identifier&>(*id).get_class(), static_cast<field_identifier&>(*id).get_field());
 					}else{
 						semantic_error("invalid member");
 						return expression_ptr();
@@ -12,35 +12,37 @@
 #include "expressions/null_check_expressions.hpp"
 #include "expressions/item_expressions.hpp"
 #include "identifiers.hpp"
+#include "arena.hpp"
 
 #include "expressions/operators.hpp"
+#include <cmath>
 
 namespace donkey{
 
 inline lvalue_expression_ptr to_l(expression_ptr e){
-	return std::static_pointer_cast<lvalue_expression>(e);
+	return static_cast<lvalue_expression*>(e);
 }
 
 inline item_expression_ptr to_item(expression_ptr e){
-	return std::static_pointer_cast<item_expression<item_handle> >(e);
+	return static_cast<item_expression<item_handle>*>(e);
 }
 
 inline l_item_expression_ptr to_litem(expression_ptr e){
-	return std::static_pointer_cast<item_expression<l_item_handle> >(e);
+	return static_cast<item_expression<l_item_handle>*>(e);
 }
 
 template<template<typename> class E>
 inline expression_ptr build_unary(expression_ptr e1){
 	if(e1->get_type() == expression_type::lvalue){
-		return expression_ptr(new E<lvalue_expression_ptr>(to_l(e1)));
+		return new_node<E<lvalue_expression_ptr> >(to_l(e1));
 	}else{
-		return expression_ptr(new E<expression_ptr>(e1));
+		return new_node<E<expression_ptr> >(e1);
 	}
 }
 
 template<class E>
 inline expression_ptr build_unary(expression_ptr e1){
-	return expression_ptr(new E(e1));
+	return new_node<E>(e1);
 }
 
 template<class E>
@@ -48,15 +50,15 @@ inline expression_ptr build_unary_l(expression_ptr e1){
 	if(e1->get_type() != expression_type::lvalue){
 		semantic_error("l-value expected");
 	}
-	return expression_ptr(new E(to_l(e1)));
+	return new_node<E>(to_l(e1));
 }
 
 template<template<typename> class E>
 inline expression_ptr build_unary_item(expression_ptr e1){
 	if(e1->get_type() == expression_type::item){
-		return expression_ptr(new E<item_expression_ptr>(to_item(e1)));
+		return new_node<E<item_expression_ptr> >(to_item(e1));
 	}else{
-		return expression_ptr(new E<l_item_expression_ptr>(to_litem(e1)));
+		return new_node<E<l_item_expression_ptr> >(to_litem(e1));
 	}
 }
 
@@ -65,29 +67,29 @@ template<template<typename, typename> class E>
 inline expression_ptr build_binary(expression_ptr e1, expression_ptr e2){
 	if(e1->get_type() == expression_type::lvalue){
 		if(e2->get_type() == expression_type::lvalue){
-			return expression_ptr(new E<lvalue_expression_ptr, lvalue_expression_ptr>(to_l(e1), to_l(e2)));
+			return new_node<E<lvalue_expression_ptr, lvalue_expression_ptr> >(to_l(e1), to_l(e2));
 		}else{
-			return expression_ptr(new E<lvalue_expression_ptr, expression_ptr>(to_l(e1), e2));
+			return new_node<E<lvalue_expression_ptr, expression_ptr> >(to_l(e1), e2);
 		}
 	}else if(e2->get_type() == expression_type::lvalue){
-		return expression_ptr(new E<expression_ptr, lvalue_expression_ptr>(e1, to_l(e2)));
+		return new_node<E<expression_ptr, lvalue_expression_ptr> >(e1, to_l(e2));
 	}else{
-		return expression_ptr(new E<expression_ptr, expression_ptr>(e1, e2));
+		return new_node<E<expression_ptr, expression_ptr> >(e1, e2);
 	}
 }
 
 template<class E>
 inline expression_ptr build_binary(expression_ptr e1, expression_ptr e2){
-	return expression_ptr(new E(e1, e2));
+	return new_node<E>(e1, e2);
 }
 
 template<template<typename> class E>
 inline expression_ptr build_binary_l(expression_ptr e1, expression_ptr e2){
 	if(e1->get_type() == expression_type::lvalue){
 		if(e2->get_type() == expression_type::lvalue){
-			return expression_ptr(new E<lvalue_expression_ptr>(to_l(e1), to_l(e2)));
+			return new_node<E<lvalue_expression_ptr> >(to_l(e1), to_l(e2));
 		}else{
-			return expression_ptr(new E<expression_ptr>(to_l(e1), e2));
+			return new_node<E<expression_ptr> >(to_l(e1), e2);
 		}
 	}else{
 		semantic_error("l-value expected");
@@ -100,22 +102,22 @@ inline expression_ptr build_binary_l(expression_ptr e1, expression_ptr e2){
 	if(e1->get_type() != expression_type::lvalue){
 		semantic_error("l-value expected");
 	}
-	return expression_ptr(new E(to_l(e1), e2));
+	return new_node<E>(to_l(e1), e2);
 }
 
 template<template<typename, typename> class E>
 inline expression_ptr build_binary_item(expression_ptr e1, expression_ptr e2){
 	if(e2->get_type() == expression_type::lvalue){
 		if(e1->get_type() == expression_type::item){
-			return expression_ptr(new E<item_expression_ptr, lvalue_expression_ptr>(to_item(e1), to_l(e2)));
+			return new_node<E<item_expression_ptr, lvalue_expression_ptr> >(to_item(e1), to_l(e2));
 		}else{
-			return expression_ptr(new E<l_item_expression_ptr, lvalue_expression_ptr>(to_litem(e1), to_l(e2)));
+			return new_node<E<l_item_expression_ptr, lvalue_expression_ptr> >(to_litem(e1), to_l(e2));
 		}
 	}else{
 		if(e1->get_type() == expression_type::item){
-			return expression_ptr(new E<item_expression_ptr, expression_ptr>(to_item(e1), e2));
+			return new_node<E<item_expression_ptr, expression_ptr> >(to_item(e1), e2);
 		}else{
-			return expression_ptr(new E<l_item_expression_ptr, expression_ptr>(to_litem(e1), e2));
+			return new_node<E<l_item_expression_ptr, expression_ptr> >(to_litem(e1), e2);
 		}
 	}
 }
@@ -123,23 +125,128 @@ inline expression_ptr build_binary_item(expression_ptr e1, expression_ptr e2){
 template<template<typename> class E>
 inline expression_ptr build_binary_item(expression_ptr e1, expression_ptr e2){
 	if(e1->get_type() == expression_type::item){
-		return expression_ptr(new E<item_expression_ptr>(to_item(e1), e2));
+		return new_node<E<item_expression_ptr> >(to_item(e1), e2);
 	}else{
-		return expression_ptr(new E<l_item_expression_ptr>(to_litem(e1), e2));
+		return new_node<E<l_item_expression_ptr> >(to_litem(e1), e2);
 	}
 }
 
 template<class E>
 inline expression_ptr build_binary_item(expression_ptr e1, expression_ptr e2){
-	return expression_ptr(new E(to_item(e1), e2));
+	return new_node<E>(to_item(e1), e2);
 }
 
 template<class E>
 inline expression_ptr build_ternary(expression_ptr e1, expression_ptr e2, expression_ptr e3){
-	return expression_ptr(new E(e1, e2, e3));
+	return new_node<E>(e1, e2, e3);
+}
+
+//operators on constant operands are evaluated while building, with the same results as at runtime
+inline bool fold_numbers(oper op, number x, number y, number& ret){
+	switch(op){
+		case oper::mul:           ret = x * y; return true;
+		case oper::div:           ret = x / y; return true;
+		case oper::mod:           ret = fmod(x, y); return true;
+		case oper::plus:          ret = x + y; return true;
+		case oper::minus:         ret = x - y; return true;
+		case oper::shiftl:        ret = (integer)x << (integer)y; return true;
+		case oper::shiftr:        ret = (integer)x >> (integer)y; return true;
+		case oper::bitwise_and:   ret = (integer)x & (integer)y; return true;
+		case oper::bitwise_xor:   ret = (integer)x ^ (integer)y; return true;
+		case oper::bitwise_or:    ret = (integer)x | (integer)y; return true;
+		case oper::less:          ret = x < y; return true;
+		case oper::greater:       ret = x > y; return true;
+		case oper::less_equal:    ret = x <= y; return true;
+		case oper::greater_equal: ret = x >= y; return true;
+		case oper::equal:         ret = x == y; return true;
+		case oper::unequal:       ret = x != y; return true;
+		case oper::logical_and:   ret = x != 0 && y != 0; return true;
+		case oper::logical_or:    ret = x != 0 || y != 0; return true;
+		case oper::idiv:
+			//division that traps is left to the runtime
+			if((integer)y == 0 || (integer)y == -1){
+				return false;
+			}
+			ret = (integer)x / (integer)y;
+			return true;
+		default:
+			return false;
+	}
+}
+
+inline bool is_assignable_expression(expression_ptr e){
+	return e->get_type() == expression_type::lvalue || e->get_type() == expression_type::item || e->get_type() == expression_type::litem;
+}
+
+inline bool constant_to_string(const variable& v, std::string& s){
+	switch(v.get_var_type()){
+		case var_type::number:
+			//non-finite numbers are formatted at runtime
+			if(!std::isfinite(v.as_number_unsafe())){
+				return false;
+			}
+			s = to_string(v.as_number_unsafe());
+			return true;
+		case var_type::string:
+			s = v.as_std_string_unsafe();
+			return true;
+		default:
+			return false;
+	}
+}
+
+inline expression_ptr fold_unary(oper op, expression_ptr e){
+	variable v;
+	if(!e->get_constant(v) || v.get_var_type() != var_type::number){
+		return expression_ptr();
+	}
+	number x = v.as_number_unsafe();
+	switch(op){
+		case oper::logical_not: return build_const_number_expression(x != 0 ? 0 : 1);
+		case oper::bitwise_not: return build_const_number_expression(~(integer)x);
+		case oper::unary_minus: return build_const_number_expression(-x);
+		case oper::unary_plus:  return build_const_number_expression(+x);
+		default:                return expression_ptr();
+	}
+}
+
+inline expression_ptr fold_binary(oper op, expression_ptr e1, expression_ptr e2){
+	variable v1;
+	variable v2;
+	if(!e1->get_constant(v1) || !e2->get_constant(v2)){
+		return expression_ptr();
+	}
+	
+	if(v1.get_var_type() == var_type::number && v2.get_var_type() == var_type::number){
+		number n;
+		return fold_numbers(op, v1.as_number_unsafe(), v2.as_number_unsafe(), n) ? build_const_number_expression(n) : expression_ptr();
+	}
+	
+	std::string s1;
+	std::string s2;
+	if(!constant_to_string(v1, s1) || !constant_to_string(v2, s2)){
+		return expression_ptr();
+	}
+	
+	switch(op){
+		case oper::concat:
+			return build_const_string_expression(s1 + s2);
+		case oper::equal:
+		case oper::unequal:
+			if(v1.get_var_type() != var_type::string || v2.get_var_type() != var_type::string){
+				return expression_ptr();
+			}
+			return build_const_number_expression((s1 == s2) == (op == oper::equal));
+		default:
+			return expression_ptr();
+	}
 }
 
 expression_ptr build_unary_expression(oper op, expression_ptr e){
+	if(expression_ptr folded = fold_unary(op, e)){
+		return folded;
+	}
+	
 	if(e->get_type() == expression_type::item || e->get_type() == expression_type::litem){
 		switch(op){
 			case oper::pre_dec:
@@ -178,7 +285,46 @@ expression_ptr build_unary_expression(oper op, expression_ptr e){
 	}
 }
 
+inline local_info* get_local_info(expression_ptr e){
+	return e->get_type() == expression_type::lvalue ? to_l(e)->get_local_info() : nullptr;
+}
+
+inline void record_store(oper op, expression_ptr e1, expression_ptr e2){
+	local_info* info = get_local_info(e1);
+	if(!info){
+		return;
+	}
+	switch(op){
+		case oper::concat_assignment:
+			info->stores.push_back(nullptr);
+			break;
+		case oper::fallback_assignment:
+		case oper::or_assignment:
+		case oper::xor_assignment:
+		case oper::and_assignment:
+		case oper::shiftr_assignment:
+		case oper::shiftl_assignment:
+		case oper::minus_assignment:
+		case oper::plus_assignment:
+		case oper::mod_assignment:
+		case oper::idiv_assignment:
+		case oper::div_assignment:
+		case oper::mul_assignment:
+		case oper::assignment:
+			info->stores.push_back(e2);
+			break;
+		default:
+			break;
+	}
+}
+
 expression_ptr build_binary_expression(oper op, expression_ptr e1, expression_ptr e2){
+	record_store(op, e1, e2);
+	
+	if(expression_ptr folded = fold_binary(op, e1, e2)){
+		return folded;
+	}
+	
 	if(e1->get_type() == expression_type::item || e1->get_type() == expression_type::litem){
 		switch(op){
 			case oper::fallback_assignment:
@@ -289,9 +435,9 @@ expression_ptr build_binary_expression(oper op, expression_ptr e1, expression_pt
 		case oper::subscript:
 			{
 				if(e1->get_type() == expression_type::lvalue){
-					return expression_ptr(new index_expression<lvalue_expression_ptr>(to_l(e1), e2));
+					return new_node<index_expression<lvalue_expression_ptr> >(to_l(e1), e2);
 				}else{
-					return expression_ptr(new index_expression<expression_ptr>(e1, e2));
+					return new_node<index_expression<expression_ptr> >(e1, e2);
 				}
 			}
 		default:
@@ -300,7 +446,24 @@ expression_ptr build_binary_expression(oper op, expression_ptr e1, expression_pt
 }
 
 
+bool get_constant_condition(expression_ptr e, bool& value){
+	variable c;
+	if(e->get_constant(c) && c.get_var_type() == var_type::number){
+		value = c.as_number_unsafe() != 0;
+		return true;
+	}
+	return false;
+}
+
+
 expression_ptr build_ternary_expression(oper op, expression_ptr e1, expression_ptr e2, expression_ptr e3){
+	//branches that could be assigned to are kept, so the result stays an r-value
+	bool cond;
+	if(op == oper::conditional_question && get_constant_condition(e1, cond) &&
+	   !is_assignable_expression(e2) && !is_assignable_expression(e3)){
+		return cond ? e2 : e3;
+	}
+	
 	switch(op){
 		case oper::conditional_question:
 			return build_ternary<conditional_expression>(e1, e2, e3);
@@ -311,68 +474,94 @@ expression_ptr build_ternary_expression(oper op, expression_ptr e1, expression_p
 
 
 expression_ptr build_function_call_expression(expression_ptr f, const std::vector<expression_ptr>& params, const std::vector<size_t>& byref){
+	for(size_t i: byref){
+		//the callee can store anything through the reference
+		if(local_info* info = get_local_info(params[i])){
+			info->stores.push_back(nullptr);
+		}
+	}
+	
 	if(byref.empty()){
-		return expression_ptr(new function_call_expression_byval(f, params));
+		return new_node<function_call_expression_byval>(f, params);
 	}else{
-		return expression_ptr(new function_call_expression(f, params, byref));
+		return new_node<function_call_expression>(f, params, byref);
 	}
 }
 
 
 expression_ptr build_null_expression(){
-	return expression_ptr(new null_expression());
+	return new_node<null_expression>();
 }
 
 expression_ptr build_this_expression(){
-	return expression_ptr(new this_expression());
+	return new_node<this_expression>();
 }
 
 expression_ptr build_const_number_expression(double n){
-	return expression_ptr(new const_number_expression(n));
+	return new_node<const_number_expression>(n);
 }
 
 expression_ptr build_const_string_expression(const std::string& str){
-	return expression_ptr(new const_string_expression(str));
+	return new_node<const_string_expression>(get_atom(str));
 }
 
-expression_ptr build_const_function_expression(code_address addr){
-	return expression_ptr(new const_function_expression(addr));
+expression_ptr build_const_function_expression(code_address addr, const std::shared_ptr<inline_function>& inl){
+	return new_node<const_function_expression>(addr, inl);
 }
 
-expression_ptr build_free_method_expression(const std::string& name, method& m){
-	return expression_ptr(new free_method_expression(name, m));
+expression_ptr build_free_method_expression(const vtable* type, method& m){
+	return new_node<free_method_expression>(type, m);
 }
 
-expression_ptr build_local_variable_expression(size_t idx){
-	return expression_ptr(new local_variable_expression(idx));
+expression_ptr build_local_variable_expression(size_t idx, local_info* info){
+	return new_node<local_variable_expression>(idx, info);
 }
 
 expression_ptr build_global_variable_expression(size_t module_idx, size_t var_idx){
-	return expression_ptr(new global_variable_expression(module_idx, var_idx));
+	return new_node<global_variable_expression>(module_idx, var_idx);
 }
 
 expression_ptr build_member_expression(expression_ptr that, const std::string& member){
-	return expression_ptr(new member_expression(that, member));
+	return new_node<member_expression>(that, member);
 }
 
-expression_ptr build_field_expression(expression_ptr that, const std::string& name, size_t idx){
-	return expression_ptr(new field_expression(that, name, idx));
+expression_ptr build_field_expression(expression_ptr that, const vtable* type, size_t idx){
+	return new_node<field_expression>(that, type, idx);
 }
 
-expression_ptr build_method_expression(expression_ptr that, const std::string& name, method& m){
-	return expression_ptr(new method_expression(that, name, m));
+expression_ptr build_method_expression(expression_ptr that, const vtable* type, method& m){
+	return new_node<method_expression>(that, type, m);
 }
 
 expression_ptr build_constructor_call_expression(vtable* vt, const std::vector<expression_ptr>& params){
 	if(vt->is_native()){
-		return expression_ptr(new creator_call_expression(vt, params));
+		return new_node<creator_call_expression>(vt, params);
 	}else{
-		return expression_ptr(new constructor_call_expression(vt, params));
+		return new_node<constructor_call_expression>(vt, params);
 	}
 }
 
 expression_ptr build_array_initializer(const std::vector<expression_ptr>& items){
-	return expression_ptr(new array_creator_call_expression(items));
+	return new_node<array_creator_call_expression>(items);
+}
+
+void infer_numeric_locals(const std::vector<local_info*>& locals){
+	//optimistic: a local stays numeric until one of its stores is shown not to be
+	for(bool changed = true; changed;){
+		changed = false;
+		for(local_info* info: locals){
+			if(!info->numeric){
+				continue;
+			}
+			for(expression_ptr e: info->stores){
+				if(!e || !e->is_numeric()){
+					info->numeric = false;
+					changed = true;
+					break;
+				}
+			}
+		}
+	}
 }
 
 }//namespace donkey
\ No newline at end of file
@@ -34,6 +34,12 @@ inline expression_type string_to_type(std::string name){
 	return expression_type::variant;
 }
 
+class bytecode_builder;
+
+class expression;
+
+typedef expression* expression_ptr;
+
 class expression{
 	expression(const expression&) = delete;
 	void operator=(const expression&) = delete;
@@ -67,6 +73,42 @@ public:
 	virtual bool as_bool(runtime_context&) = 0;
 
 	virtual void as_void(runtime_context&) = 0;
+	
+	//bytecode lowering; returning false leaves the expression to the tree interpreter
+	virtual bool lower(bytecode_builder&, int){
+		return false;
+	}
+	
+	virtual bool lower_operand(bytecode_builder&, int&){
+		return false;
+	}
+	
+	virtual bool lower_branch(bytecode_builder&, bool, int){
+		return false;
+	}
+	
+	virtual bool lower_store(bytecode_builder&, const expression_ptr&, int){
+		return false;
+	}
+	
+	virtual bool lower_call(bytecode_builder&, const std::vector<expression_ptr>&, int){
+		return false;
+	}
+	
+	//lowers 'return <this>' so that the callee reuses the caller's frame
+	virtual bool lower_tail_call(bytecode_builder&){
+		return false;
+	}
+	
+	//true if the value is known to be a number once numeric locals are inferred
+	virtual bool is_numeric(){
+		return _t == expression_type::number;
+	}
+	
+	//value known at compile time
+	virtual bool get_constant(variable&){
+		return false;
+	}
 
 
 	expression_type get_type(){
@@ -77,8 +119,6 @@ public:
 	}
 };
 
-typedef std::shared_ptr<expression> expression_ptr;
-
 inline bool is_variant_expression(expression_ptr e){
 	return e->get_type() == expression_type::lvalue || e->get_type() == expression_type::variant || e->get_type() == expression_type::item;
 }
@@ -96,6 +136,31 @@ inline expression_type combined_expression_type(expression_ptr e1, expression_pt
 	return expression_type::string;
 }
 
+//a local declaration; it is numeric if it is initialized where declared and everything stored into it is numeric
+struct local_info{
+	std::vector<expression_ptr> stores; //nullptr for stores of unknown type
+	bool numeric;
+	
+	local_info():
+		numeric(false){
+	}
+};
+
+void infer_numeric_locals(const std::vector<local_info*>& locals);
+
+//a function whose body is one small return statement, lowered again at the call sites compiled after it;
+//e stays nullptr until the function is defined, and when it cannot be inlined
+struct inline_function{
+	expression_ptr e; //its locals are the params
+	size_t params_count;
+	std::string name;
+	
+	inline_function():
+		e(nullptr),
+		params_count(0){
+	}
+};
+
 class lvalue_expression: public expression{
 protected:
 	lvalue_expression():
@@ -103,6 +168,10 @@ protected:
 	}
 public:
 	virtual variable& as_lvalue(runtime_context&) = 0;
+	
+	virtual local_info* get_local_info(){
+		return nullptr;
+	}
 
 	virtual variable as_param(runtime_context& ctx) override{
 		return as_lvalue(ctx);
@@ -133,7 +202,7 @@ public:
 	}
 };
 
-typedef std::shared_ptr<lvalue_expression> lvalue_expression_ptr;
+typedef lvalue_expression* lvalue_expression_ptr;
 
 struct item_handle{
 	item_handle(const item_handle& orig) = delete;
@@ -220,6 +289,10 @@ protected:
 public:
 	virtual Handle as_item(runtime_context&) = 0;
 	
+	virtual bool lower_item(bytecode_builder&, int&, int&){
+		return false;
+	}
+	
 	virtual variable as_param(runtime_context& ctx) override{
 		return get_this_item(ctx);
 	}
@@ -242,8 +315,8 @@ public:
 };
 
 
-typedef std::shared_ptr<item_expression<item_handle> > item_expression_ptr;
-typedef std::shared_ptr<item_expression<l_item_handle> > l_item_expression_ptr;
+typedef item_expression<item_handle>* item_expression_ptr;
+typedef item_expression<l_item_handle>* l_item_expression_ptr;
 
 template<class Expression>
 struct handle_version{
@@ -256,7 +329,7 @@ struct handle_version<lvalue_expression_ptr>{
 };
 
 template<typename Handle>
-struct handle_version<std::shared_ptr<item_expression<Handle> > >{
+struct handle_version<item_expression<Handle>*>{
 	typedef Handle type;
 };
 
@@ -334,11 +407,11 @@ expression_ptr build_const_number_expression(double n);
 
 expression_ptr build_const_string_expression(const std::string& str);
 
-expression_ptr build_const_function_expression(code_address addr);
+expression_ptr build_const_function_expression(code_address addr, const std::shared_ptr<inline_function>& inl);
 
-expression_ptr build_free_method_expression(const std::string& name, method& m);
+expression_ptr build_free_method_expression(const vtable* type, method& m);
 
-expression_ptr build_local_variable_expression(size_t idx);
+expression_ptr build_local_variable_expression(size_t idx, local_info* info);
 
 expression_ptr build_global_variable_expression(size_t module_idx, size_t var_idx);
 
@@ -348,11 +421,14 @@ expression_ptr build_binary_expression(oper op, expression_ptr e1, expression_pt
 
 expression_ptr build_ternary_expression(oper op, expression_ptr e1, expression_ptr e2, expression_ptr e3);
 
+//condition that is a number known at compile time
+bool get_constant_condition(expression_ptr e, bool& value);
+
 expression_ptr build_member_expression(expression_ptr that, const std::string& member);
 
-expression_ptr build_field_expression(expression_ptr that, const std::string& name, size_t idx);
+expression_ptr build_field_expression(expression_ptr that, const vtable* type, size_t idx);
 
-expression_ptr build_method_expression(expression_ptr that, const std::string& name, method& m);
+expression_ptr build_method_expression(expression_ptr that, const vtable* type, method& m);
 
 expression_ptr build_constructor_call_expression(vtable* vt, const std::vector<expression_ptr>& params);
 
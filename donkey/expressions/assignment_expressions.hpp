@@ -21,6 +21,14 @@ public:
 		auto v = _e2->as_var(ctx);
 		return _e1->as_lvalue(ctx) = v;
 	}
+	
+	virtual bool lower(bytecode_builder& b, int dst) override{
+		return _e1->lower_store(b, _e2, dst);
+	}
+	
+	virtual bool is_numeric() override{
+		return _e1->is_numeric() && _e2->is_numeric();
+	}
 };
 
 NUMBER_BINARY_L_CPP(mul_assignment, mul_assign, *=)
@@ -43,14 +51,19 @@ public:
 		n1 = integer(n1)/integer(n2);
 		return v1;
 	}
+	
+	virtual bool is_numeric() override{
+		return _e1->is_numeric();
+	}
 };
 
 void mod_assign_full(variable& l, const variable& r, runtime_context& ctx);
 inline void mod_assign(variable& l, const variable& r, runtime_context& ctx) {
 	if(l.get_var_type() == var_type::number && r.get_var_type() == var_type::number){
 		l.as_lnumber_unsafe() = fmod(l.as_number_unsafe(), r.as_number_unsafe());
+	}else{
+		mod_assign_full(l, r, ctx);
 	}
-	mod_assign_full(l, r, ctx);
 }
 BIN_OPERATOR_L(mod_assignment, mod_assign)
 
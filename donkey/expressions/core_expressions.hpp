@@ -2,6 +2,8 @@
 #define __core_expressions_hpp__
 
 #include "expressions.hpp"
+#include "compilers/bytecode_compiler.hpp"
+#include "member_cache.hpp"
 
 namespace donkey{
 
@@ -22,6 +24,18 @@ public:
 	virtual bool as_bool(runtime_context& ctx) override{
 		return as_param(ctx).to_bool(ctx);
 	}
+	
+	virtual bool lower(bytecode_builder& b, int dst) override{
+		if(dst >= 0){
+			b.emit(vm_op::null, dst);
+		}
+		return true;
+	}
+	
+	virtual bool lower_operand(bytecode_builder& b, int& r) override{
+		r = b.constant(variable());
+		return true;
+	}
 };
 
 class this_expression final: public expression{
@@ -84,16 +98,32 @@ public:
 	virtual bool as_bool(runtime_context& ctx) override{
 		return as_number(ctx) != 0;
 	}
+
+	virtual bool lower(bytecode_builder& b, int dst) override{
+		if(dst >= 0){
+			b.emit(vm_op::move, dst, b.constant(_d));
+		}
+		return true;
+	}
+	
+	virtual bool lower_operand(bytecode_builder& b, int& r) override{
+		r = b.constant(_d);
+		return true;
+	}
 	
+	virtual bool get_constant(variable& v) override{
+		v = _d;
+		return true;
+	}
 };
 
 class const_string_expression final: public expression{
 private:
 	variable _s;
 public:
-	const_string_expression(std::string s):
+	const_string_expression(atom s):
 		expression(expression_type::string),
-		_s(s){
+		_s(get_string_constant(s)){
 	}
 	virtual std::string as_string(runtime_context&) override{
 		return _s.as_string_unsafe();
@@ -108,15 +138,34 @@ public:
 	virtual bool as_bool(runtime_context& ctx) override{
 		return _s.to_bool(ctx);
 	}
+
+	virtual bool lower(bytecode_builder& b, int dst) override{
+		if(dst >= 0){
+			b.emit(vm_op::move, dst, b.constant(_s));
+		}
+		return true;
+	}
+	
+	virtual bool lower_operand(bytecode_builder& b, int& r) override{
+		r = b.constant(_s);
+		return true;
+	}
+	
+	virtual bool get_constant(variable& v) override{
+		v = _s;
+		return true;
+	}
 };
 
 class const_function_expression final: public expression{
 private:
 	code_address _f;
+	std::shared_ptr<inline_function> _inline;
 public:
-	const_function_expression(code_address f):
+	const_function_expression(code_address f, const std::shared_ptr<inline_function>& inl):
 		expression(expression_type::function),
-		_f(f){
+		_f(f),
+		_inline(inl){
 	}
 	virtual variable call(runtime_context& ctx, size_t params_size) override{
 		return call_function_by_address(_f, ctx, params_size);
@@ -134,14 +183,30 @@ public:
 	virtual bool as_bool(runtime_context& ctx) override{
 		return as_param(ctx).to_bool(ctx);
 	}
+	virtual bool lower(bytecode_builder& b, int dst) override{
+		if(dst >= 0){
+			b.emit(vm_op::move, dst, b.constant(variable(_f)));
+		}
+		return true;
+	}
+	
+	virtual bool lower_operand(bytecode_builder& b, int& r) override{
+		r = b.constant(variable(_f));
+		return true;
+	}
+	
+	virtual bool lower_call(bytecode_builder& b, const std::vector<expression_ptr>& params, int dst) override{
+		b.call_function(_f, _inline.get(), params, dst);
+		return true;
+	}
 };
 
 class free_method_expression final: public expression{
 private:
 	method& _m;
-	std::string _type;
+	const vtable* _type;
 public:
-	free_method_expression(const std::string& type, method& m):
+	free_method_expression(const vtable* type, method& m):
 		expression(expression_type::function),
 		_m(m),
 		_type(type){
@@ -151,7 +216,7 @@ public:
 			runtime_error("method called without object");
 		}
 		variable that = ctx.top(params_size-1);
-		return that.get_vtable()->call_method(that, ctx, params_size-1, _type, _m);
+		return that.get_vtable()->call_method(that, ctx, params_size-1, *_type, _m);
 	}
 	virtual std::string as_string(runtime_context&) override{
 		return "method";
@@ -174,14 +239,45 @@ public:
 class local_variable_expression final: public lvalue_expression{
 private:
 	size_t _idx;
+	local_info* _info;
 public:
-	local_variable_expression(size_t idx):
-		_idx(idx){
+	local_variable_expression(size_t idx, local_info* info):
+		_idx(idx),
+		_info(info){
 	}
 
 	virtual variable& as_lvalue(runtime_context& ctx) override{
 		return ctx.local(_idx);
 	}
+	
+	virtual bool lower(bytecode_builder& b, int dst) override{
+		int r = b.local(_idx);
+		if(dst >= 0 && dst != r){
+			b.emit(vm_op::move, dst, r);
+		}
+		return true;
+	}
+	
+	virtual bool lower_operand(bytecode_builder& b, int& r) override{
+		r = b.local(_idx);
+		return true;
+	}
+	
+	virtual bool lower_store(bytecode_builder& b, const expression_ptr& e, int dst) override{
+		int r = b.local(_idx);
+		b.value(e, r);
+		if(dst >= 0 && dst != r){
+			b.emit(vm_op::move, dst, r);
+		}
+		return true;
+	}	
+	virtual local_info* get_local_info() override{
+		return _info;
+	}
+	
+	virtual bool is_numeric() override{
+		return _info->numeric;
+	}
 };
 
 class global_variable_expression final: public lvalue_expression{
@@ -196,59 +292,52 @@ public:
 	virtual variable& as_lvalue(runtime_context & ctx) override{
 		return global_variable(ctx, _module_idx, _var_idx);
 	}
+	
+	virtual bool lower(bytecode_builder& b, int dst) override{
+		if(dst >= 0){
+			b.emit(vm_op::load_global, dst, _module_idx, _var_idx);
+		}
+		return true;
+	}
+	
+	virtual bool lower_store(bytecode_builder& b, const expression_ptr& e, int dst) override{
+		int r = b.target(dst);
+		b.value(e, r);
+		b.emit(vm_op::store_global, _module_idx, _var_idx, r);
+		return true;
+	}
 };
 
 class member_expression final: public lvalue_expression{
 private:
-	std::string _name;
+	atom _name;
 	expression_ptr _that;
-	vtable* _vt;
-	method* _m;
-	size_t _f;
-	
-	void update_member(const variable& that){
-		vtable* vt = that.get_vtable();
-		
-		if(vt != _vt){
-			if(vt->has_field(_name)){
-				_f = vt->get_field_index(_name);
-				_m = nullptr;
-			}else if(vt->has_method(_name)){
-				_f = size_t(-1);
-				_m = vt->get_method(_name).get();
-			}
-			_vt = vt;
-		}
-	}
-	
+	member_cache _cache;
 public:
-	member_expression(expression_ptr that, std::string name):
-		_name(name),
-		_that(that),
-		_vt(nullptr),
-		_m(nullptr),
-		_f(size_t(-1)){
+	member_expression(expression_ptr that, const std::string& name):
+		_name(get_atom(name)),
+		_that(that){
 	}
 	
 	virtual variable& as_lvalue(runtime_context& ctx) override{
 		variable that = _that->as_param(ctx);
-		update_member(that);
-		if(_f == size_t(-1)){
-			runtime_error("field " + _name + " is not defined for " + that.get_full_type_name());
+		member_info member = _cache.find(that.get_vtable(), _name);
+		if(member.field == size_t(-1)){
+			runtime_error("field " + *_name + " is not defined for " + that.get_full_type_name());
 		}
-		return that.nth_field(_f);
+		return that.nth_field(member.field);
 	}
 	
 	virtual variable call(runtime_context &ctx, size_t params_size) override{
 		variable that = _that->as_param(ctx);
-		update_member(that);
+		member_info member = _cache.find(that.get_vtable(), _name);
 		
-		if(_m){
-			return (*_m)(that, ctx, params_size);
-		}else if(_f != size_t(-1)){
-			return that.nth_field(_f).call(ctx, params_size);
+		if(member.m){
+			return (*member.m)(that, ctx, params_size);
+		}else if(member.field != size_t(-1)){
+			return that.nth_field(member.field).call(ctx, params_size);
 		}else{
-			runtime_error("member " + _name + " is not defined for " + that.get_full_type_name());
+			runtime_error("member " + *_name + " is not defined for " + that.get_full_type_name());
 			return variable();
 		}
 	}
@@ -273,10 +362,10 @@ public:
 class field_expression final: public lvalue_expression{
 private:
 	expression_ptr _that;
-	std::string _type;
-	int _idx;
+	const vtable* _type;
+	size_t _idx;
 public:
-	field_expression(expression_ptr that, std::string type, int idx):
+	field_expression(expression_ptr that, const vtable* type, size_t idx):
 		_that(that),
 		_type(type),
 		_idx(idx){
@@ -284,17 +373,17 @@ public:
 
 	virtual variable& as_lvalue(runtime_context& ctx) override{
 		variable that = _that->as_param(ctx);
-		return that.get_vtable()->get_field(that, _type, _idx);
+		return that.get_vtable()->get_field(that, *_type, _idx);
 	}
 };
 
 class method_expression final: public expression{
 private:
 	expression_ptr _that;
-	std::string _type;
+	const vtable* _type;
 	method& _m;
 public:
-	method_expression(expression_ptr that, const std::string& type, method& m):
+	method_expression(expression_ptr that, const vtable* type, method& m):
 		expression(expression_type::function),
 		_that(that),
 		_type(type),
@@ -302,7 +391,7 @@ public:
 	}
 	virtual variable call(runtime_context& ctx, size_t params_size) override{
 		variable that = _that->as_param(ctx);
-		return that.get_vtable()->call_method(that, ctx, params_size, _type, _m);
+		return that.get_vtable()->call_method(that, ctx, params_size, *_type, _m);
 	}
 	virtual std::string as_string(runtime_context&) override{
 		runtime_error("methods cannot be used as objects");
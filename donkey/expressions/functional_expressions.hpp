@@ -2,13 +2,19 @@
 #define __functional_expressions_hpp__
 
 #include "expressions.hpp"
+#include "compilers/bytecode_compiler.hpp"
 
 #include "vtable.hpp"
+#include "call_stack.hpp"
 
 namespace donkey{
 
 class function_call_expression final: public expression{
 private:
+	enum{
+		inline_refs_size = 8,
+	};
+	
 	std::vector<expression_ptr> _params;
 	std::vector<bool> _byref;
 	expression_ptr _f;
@@ -17,7 +23,7 @@ public:
 	function_call_expression(expression_ptr f, std::vector<expression_ptr> params, std::vector<size_t> byref):
 		expression(expression_type::variant),
 		_params(std::move(params)),
-		_byref(params.size()),
+		_byref(_params.size()),
 		_f(f){
 		
 		for(auto sz: byref){
@@ -38,7 +44,15 @@ public:
 	}
 
 	virtual variable as_param(runtime_context& ctx) final override{
-		std::vector<variable*> refs(_params.size());
+		//calls with few params keep their references on the native stack
+		variable* inline_refs[inline_refs_size];
+		std::unique_ptr<variable*[]> heap_refs;
+		variable** refs = inline_refs;
+		
+		if(_params.size() > inline_refs_size){
+			heap_refs.reset(new variable*[_params.size()]);
+			refs = heap_refs.get();
+		}
 	
 		stack_pusher pusher(ctx, _params.size());
 		
@@ -114,6 +128,15 @@ public:
 	virtual bool as_bool(runtime_context& ctx) final override{
 		return as_param(ctx).to_bool(ctx);
 	}
+	
+	virtual bool lower(bytecode_builder& b, int dst) final override{
+		b.call(_f, _params, dst);
+		return true;
+	}
+	
+	virtual bool lower_tail_call(bytecode_builder& b) final override{
+		return b.tail_call(_f, _params);
+	}
 };
 
 
@@ -169,6 +192,7 @@ class creator_call_expression final: public expression{
 private:
 	vtable* _vt;
 	std::vector<expression_ptr> _params;
+	std::string _name;
 	
 	variable create(runtime_context& ctx){
 		stack_pusher pusher(ctx, _params.size());
@@ -176,19 +200,17 @@ private:
 		for(size_t i = 0; i < _params.size(); ++i){
 			pusher.push(_params[i]->as_param(ctx));
 		}
-		try{
-			return _vt->create(ctx, _params.size());
-		}catch(const runtime_exception& e){
-			e.add_stack_trace(_vt->get_full_name() + "::" + _vt->get_name());
-		}
-		return variable();
+		
+		call_stack_frame frame(_name);
+		return _vt->create(ctx, _params.size());
 	}
 	
 public:
 	creator_call_expression(vtable* vt, std::vector<expression_ptr> params):
 		expression(expression_type::variant),
 		_vt(vt),
-		_params(std::move(params)){
+		_params(std::move(params)),
+		_name(vt->get_full_name() + "::" + vt->get_name()){
 	}
 	virtual variable as_param(runtime_context& ctx) override{
 		return create(ctx);
@@ -20,13 +20,29 @@ public:
 		_e2(e2){
 	}
 	
+	//the object is evaluated before the index, as in bytecode
 	virtual handle as_item(runtime_context& ctx) override{
-		return handle(_e1->as_var(ctx), _e2->as_param(ctx));
+		auto&& that = _e1->as_var(ctx);
+		variable index = _e2->as_param(ctx);
+		return handle(std::forward<decltype(that)>(that), std::move(index));
 	}
 	
 	virtual void as_void(runtime_context& ctx) override{
 		_e1->as_void(ctx), _e2->as_void(ctx);
 	}
+	
+	virtual bool lower_item(bytecode_builder& b, int& that, int& index) override{
+		that = b.operand(_e1);
+		index = b.operand(_e2);
+		return true;
+	}
+	
+	virtual bool lower(bytecode_builder& b, int dst) override{
+		int that = b.operand(_e1);
+		int index = b.operand(_e2);
+		b.emit(vm_op::get_item, b.target(dst), that, index);
+		return true;
+	}
 };
 
 ITEM_PRE_OPERATOR(item_pre_inc, pre_inc)
@@ -56,6 +72,30 @@ public:
 		handle ret = _e1->as_item(ctx);
 		set_item(ctx, ret.that, std::move(ret.index), _e2->as_param(ctx));
 	}
+	
+	virtual bool lower(bytecode_builder& b, int dst) override{
+		int that;
+		int index;
+		if(!_e1->lower_item(b, that, index)){
+			return false;
+		}
+		
+		int value;
+		if(!_e2->lower_operand(b, value)){
+			if(index >= 0){
+				int t = b.temp();
+				b.emit(vm_op::move, t, index);
+				index = t;
+			}
+			value = b.operand(_e2);
+		}
+		
+		b.emit(vm_op::set_item, that, index, value);
+		if(dst >= 0){
+			b.emit(vm_op::get_item, dst, that, index);
+		}
+		return true;
+	}
 };
 
 ITEM_ASSIGN_OPERATOR(item_mul_assignment, mul_assign)
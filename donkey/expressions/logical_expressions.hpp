@@ -2,6 +2,7 @@
 #define __logical_expressions_hpp__
 
 #include "expressions.hpp"
+#include "compilers/bytecode_compiler.hpp"
 
 namespace donkey{
 
@@ -30,6 +31,24 @@ public:
 	virtual bool as_bool(runtime_context& ctx) override{
 		return _e1->as_bool(ctx) && _e2->as_bool(ctx);
 	}
+	
+	virtual bool lower(bytecode_builder& b, int dst) override{
+		b.materialize(*this, dst);
+		return true;
+	}
+	
+	virtual bool lower_branch(bytecode_builder& b, bool when, int label) override{
+		if(when){
+			int skip = b.new_label();
+			b.branch(_e1, false, skip);
+			b.branch(_e2, true, label);
+			b.bind(skip);
+		}else{
+			b.branch(_e1, false, label);
+			b.branch(_e2, false, label);
+		}
+		return true;
+	}
 };
 
 class logical_or_expression final: public expression{
@@ -57,6 +76,24 @@ public:
 	virtual bool as_bool(runtime_context& ctx) override{
 		return _e1->as_bool(ctx) || _e2->as_bool(ctx);
 	}
+	
+	virtual bool lower(bytecode_builder& b, int dst) override{
+		b.materialize(*this, dst);
+		return true;
+	}
+	
+	virtual bool lower_branch(bytecode_builder& b, bool when, int label) override{
+		if(when){
+			b.branch(_e1, true, label);
+			b.branch(_e2, true, label);
+		}else{
+			int skip = b.new_label();
+			b.branch(_e1, true, skip);
+			b.branch(_e2, false, label);
+			b.bind(skip);
+		}
+		return true;
+	}
 };
 
 }//donkey
@@ -67,8 +67,28 @@ void name##_full(variable& l, const variable& r, runtime_context& ctx){\
 }
 
 
-BINARY_SIMPLE(eq, EQ)
-BINARY_SIMPLE(ne, NE)
+//strings are compared without calling the operator
+static bool both_strings(const variable& l, const variable& r){
+	return l.get_data_type() == var_type::string && r.get_data_type() == var_type::string;
+}
+
+static BINARY_SIMPLE(eq_operator, EQ)
+static BINARY_SIMPLE(ne_operator, NE)
+
+variable eq_full(const variable& l, const variable& r, runtime_context& ctx){
+	if(both_strings(l, r)){
+		return variable(number(l.string_equals_unsafe(r)));
+	}
+	return eq_operator_full(l, r, ctx);
+}
+
+variable ne_full(const variable& l, const variable& r, runtime_context& ctx){
+	if(both_strings(l, r)){
+		return variable(number(!l.string_equals_unsafe(r)));
+	}
+	return ne_operator_full(l, r, ctx);
+}
+
 BINARY_DOUBLE(lt, LT)
 BINARY_DOUBLE(gt, GT)
 BINARY_DOUBLE(le, LE)
@@ -3,6 +3,7 @@
 
 #include "variables.hpp"
 #include "expressions.hpp"
+#include "compilers/bytecode_compiler.hpp"
 
 namespace donkey{
 
@@ -32,6 +33,14 @@ public:\
 		return as_param(ctx).to_bool(ctx);\
 	}\
 \
+	virtual bool lower(bytecode_builder& b, int dst) override{\
+		b.unary(oper::name, _e, dst);\
+		return true;\
+	}\
+\
+	virtual bool is_numeric() override{\
+		return _e->is_numeric();\
+	}\
 };
 
 #define UN_OPERATOR_L(name, op)\
@@ -48,6 +57,14 @@ public:\
 		op(v, ctx);\
 		return v;\
 	}\
+\
+	virtual bool lower(bytecode_builder& b, int dst) override{\
+		return b.increment(oper::name, _e, dst);\
+	}\
+\
+	virtual bool is_numeric() override{\
+		return _e->is_numeric();\
+	}\
 };
 
 #define POST_OPERATOR(name, op)\
@@ -75,6 +92,13 @@ public:\
 		return as_param(ctx).to_bool(ctx);\
 	}\
 \
+	virtual bool lower(bytecode_builder& b, int dst) override{\
+		return b.increment(oper::name, _e, dst);\
+	}\
+\
+	virtual bool is_numeric() override{\
+		return _e->is_numeric();\
+	}\
 };
 
 #define BIN_OPERATOR(name, op)\
@@ -95,7 +119,8 @@ public:\
 	}\
 \
 	virtual variable as_param(runtime_context& ctx) override{\
-		return op(_e1->as_var(ctx), _e2->as_var(ctx), ctx);\
+		variable l = _e1->as_var(ctx);\
+		return op(l, _e2->as_var(ctx), ctx);\
 	}\
 \
 	virtual void as_void(runtime_context& ctx) override{\
@@ -104,6 +129,19 @@ public:\
 	virtual bool as_bool(runtime_context& ctx) override{\
 		return as_param(ctx).to_bool(ctx);\
 	}\
+\
+	virtual bool lower(bytecode_builder& b, int dst) override{\
+		b.binary(oper::name, _e1, _e2, dst);\
+		return true;\
+	}\
+\
+	virtual bool lower_branch(bytecode_builder& b, bool when, int label) override{\
+		return b.compare(oper::name, _e1, _e2, when, label);\
+	}\
+\
+	virtual bool is_numeric() override{\
+		return _e1->is_numeric() && _e2->is_numeric();\
+	}\
 };
 
 #define BIN_OPERATOR_L(name, op)\
@@ -124,6 +162,14 @@ public:\
 		op(v1, v2, ctx);\
 		return v1;\
 	}\
+\
+	virtual bool lower(bytecode_builder& b, int dst) override{\
+		return b.compound_assignment(oper::name, _e1, _e2, dst);\
+	}\
+\
+	virtual bool is_numeric() override{\
+		return _e1->is_numeric() && _e2->is_numeric();\
+	}\
 };
 
 #define ITEM_PRE_OPERATOR(name, op)\
@@ -2,6 +2,7 @@
 #define __sequential_expressions_hpp__
 
 #include "expressions.hpp"
+#include "compilers/bytecode_compiler.hpp"
 
 namespace donkey{
 
@@ -40,6 +41,21 @@ public:
 	virtual bool as_bool(runtime_context& ctx) override{
 		return _e1->as_void(ctx), _e2->as_bool(ctx); 
 	}
+	
+	virtual bool lower(bytecode_builder& b, int dst) override{
+		b.value(_e1, -1);
+		b.value(_e2, dst);
+		return true;
+	}
+	
+	virtual bool lower_branch(bytecode_builder& b, bool when, int label) override{
+		b.value(_e1, -1);
+		b.branch(_e2, when, label);
+		return true;
+	}	
+	virtual bool is_numeric() override{
+		return _e2->is_numeric();
+	}
 };
 
 }//donkey
@@ -5,19 +5,45 @@
 
 namespace donkey{
 
+//evaluates e as a string, without copying a string it already holds
+inline variable string_operand(const expression_ptr& e, runtime_context& ctx){
+	if(e->get_type() != expression_type::string && !is_variant_expression(e)){
+		return variable(e->as_string(ctx));
+	}
+	variable v = e->as_param(ctx);
+	if(v.get_data_type() != var_type::string){
+		return variable(v.to_string(ctx));
+	}
+	return v;
+}
+
+//chains of .. are flattened into one expression that builds the result in a single buffer
 class concat_expression final: public expression{
 private:
-	expression_ptr _e1;
-	expression_ptr _e2;
+	std::vector<expression_ptr> _parts;
+	
+	void add_part(expression_ptr e){
+		if(concat_expression* c = dynamic_cast<concat_expression*>(e)){
+			_parts.insert(_parts.end(), c->_parts.begin(), c->_parts.end());
+		}else{
+			_parts.push_back(e);
+		}
+	}
+	
 public:
 	concat_expression(expression_ptr e1, expression_ptr e2):
-		expression(expression_type::string),
-		_e1(e1),
-		_e2(e2){
+		expression(expression_type::string){
+		add_part(e1);
+		add_part(e2);
 	}
 
 	virtual std::string as_string(runtime_context& ctx) override{
-		return _e1->as_string(ctx) + _e2->as_string(ctx);
+		std::string ret;
+		for(const expression_ptr& e: _parts){
+			variable v = string_operand(e, ctx);
+			ret.append(v.as_string_unsafe(), v.string_length_unsafe());
+		}
+		return ret;
 	}
 
 	virtual variable as_param(runtime_context& ctx) override{
@@ -32,6 +58,7 @@ public:
 	}
 };
 
+//appends in place when the target holds the only reference to its string
 class concat_assignment_expression final: public lvalue_expression{
 private:
 	lvalue_expression_ptr _e1;
@@ -43,9 +70,12 @@ public:
 	}
 	
 	virtual variable& as_lvalue(runtime_context& ctx) override{
-		std::string str = _e2->as_string(ctx);
+		variable str = string_operand(_e2, ctx);
 		variable& v = _e1->as_lvalue(ctx);
-		v = variable(v.to_string(ctx) + std::move(str));
+		if(v.get_data_type() != var_type::string){
+			v = variable(v.to_string(ctx));
+		}
+		v.append_string(str.as_string_unsafe(), str.string_length_unsafe());
 		return v;
 	}
 	
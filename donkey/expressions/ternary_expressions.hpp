@@ -2,6 +2,7 @@
 #define __ternary_expressions_hpp__
 
 #include "expressions.hpp"
+#include "compilers/bytecode_compiler.hpp"
 
 namespace donkey{
 
@@ -41,6 +42,35 @@ public:
 	virtual bool as_bool(runtime_context& ctx) override{
 		return _e1->as_bool(ctx) ? _e2->as_bool(ctx) : _e3->as_bool(ctx);
 	}
+	
+	virtual bool lower(bytecode_builder& b, int dst) override{
+		int els = b.new_label();
+		int end = b.new_label();
+		
+		b.branch(_e1, false, els);
+		b.value(_e2, dst);
+		b.emit(vm_op::jump, end);
+		b.bind(els);
+		b.value(_e3, dst);
+		b.bind(end);
+		return true;
+	}
+	
+	virtual bool lower_branch(bytecode_builder& b, bool when, int label) override{
+		int els = b.new_label();
+		int end = b.new_label();
+		
+		b.branch(_e1, false, els);
+		b.branch(_e2, when, label);
+		b.emit(vm_op::jump, end);
+		b.bind(els);
+		b.branch(_e3, when, label);
+		b.bind(end);
+		return true;
+	}	
+	virtual bool is_numeric() override{
+		return _e2->is_numeric() && _e3->is_numeric();
+	}
 };
 
 }//donkey
@@ -44,6 +44,16 @@ public:
 	virtual bool as_bool(runtime_context& ctx) override{
 		return !_e->as_bool(ctx);
 	}
+	
+	virtual bool lower(bytecode_builder& b, int dst) override{
+		b.unary(oper::logical_not, _e, dst);
+		return true;
+	}
+	
+	virtual bool lower_branch(bytecode_builder& b, bool when, int label) override{
+		b.branch(_e, !when, label);
+		return true;
+	}
 };
 
 }//donkey
@@ -6,6 +6,9 @@
 
 namespace donkey{
 
+struct local_info;
+struct inline_function;
+
 enum class identifier_type{
 	global_variable,
 	local_variable,
@@ -67,29 +70,41 @@ public:
 class local_variable_identifier: public identifier{
 private:
 	size_t _idx;
+	local_info* _info;
 public:
-	local_variable_identifier(const std::string& name, size_t idx):
+	local_variable_identifier(const std::string& name, size_t idx, local_info* info):
 		identifier(identifier_type::local_variable, name),
-		_idx(idx){
+		_idx(idx),
+		_info(info){
 	}
 	
 	size_t get_index() const{
 		return _idx;
 	}
+	
+	local_info* get_info() const{
+		return _info;
+	}
 };
 
 class function_identifier: public identifier{
 private:
 	code_address _f;
+	std::shared_ptr<inline_function> _inline; //nullptr for functions of other modules
 public:
-	function_identifier(const std::string& name, code_address f):
+	function_identifier(const std::string& name, code_address f, std::shared_ptr<inline_function> inl = std::shared_ptr<inline_function>()):
 		identifier(identifier_type::function, name),
-		_f(f){
+		_f(f),
+		_inline(inl){
 	}
 	
 	const code_address& get_function() const{
 		return _f;
 	}
+	
+	const std::shared_ptr<inline_function>& get_inline() const{
+		return _inline;
+	}
 };
 
 typedef std::shared_ptr<function_identifier> function_identifier_ptr;
@@ -134,40 +149,40 @@ typedef std::shared_ptr<module_identifier> module_identifier_ptr;
 class method_identifier: public identifier{
 private:
 	method& _m;
-	std::string _classname;
+	const vtable* _class;
 public:
-	method_identifier(const std::string& name, method& m, std::string classname):
+	method_identifier(const std::string& name, method& m, const vtable* cls):
 		identifier(identifier_type::method, name),
 		_m(m),
-		_classname(std::move(classname)){
+		_class(cls){
 	}
 	
 	method& get_method() const{
 		return _m;
 	}
 	
-	const std::string& get_classname() const{
-		return _classname;
+	const vtable* get_class() const{
+		return _class;
 	}
 };
 
 class field_identifier: public identifier{
 private:
 	size_t _f;
-	std::string _classname;
+	const vtable* _class;
 public:
-	field_identifier(const std::string& name, size_t f, std::string classname):
+	field_identifier(const std::string& name, size_t f, const vtable* cls):
 		identifier(identifier_type::field, name),
 		_f(f),
-		_classname(std::move(classname)){
+		_class(cls){
 	}
 	
 	size_t get_field() const{
 		return _f;
 	}
 	
-	const std::string& get_classname() const{
-		return _classname;
+	const vtable* get_class() const{
+		return _class;
 	}
 };
 
@@ -1,5 +1,8 @@
 #include "donkey.hpp"
 #include <cstdio>
+#include <clocale>
+#include <cstring>
+#include <cstdlib>
 
 #include "modules/io/io_module.hpp"
 #include "modules/containers/containers_module.hpp"
@@ -10,14 +13,36 @@
 int main(int argc, char* argv[]){
 	setlocale(LC_ALL, "");
 
+	const char* exe = argv[0];
+	donkey::execution_mode mode = donkey::execution_mode::bytecode;
+	bool lazy = false;
+	bool cache = false;
+	size_t threads = 1;
+	
+	for(; argc > 1; --argc, ++argv){
+		if(strcmp(argv[1], "--tree") == 0){
+			mode = donkey::execution_mode::tree;
+		}else if(strcmp(argv[1], "--lazy") == 0){
+			lazy = true;
+		}else if(strcmp(argv[1], "--cache") == 0){
+			cache = true;
+		}else if(strcmp(argv[1], "--jobs") == 0 && argc > 2){
+			threads = strtoul(argv[2], nullptr, 10);
+			--argc;
+			++argv;
+		}else{
+			break;
+		}
+	}
+
 	if(argc < 2 || argc > 3){
-		printf("usage %s <module> [directory (current is default)]\n", argv[0]);
+		printf("usage %s [--tree] [--lazy] [--cache] [--jobs n] <module> [directory (current is default)]\n", exe);
 		return 1;
 	}
 
 	const char* root = (argc == 3 ? argv[2] : ".");
 
-	donkey::compiler c(root);
+	donkey::compiler c(root, 1024, mode, lazy, cache, threads);
 	
 	c.add_module_loader("io", &donkey::load_io_module);
 	c.add_module_loader("containers", &donkey::load_containers_module);
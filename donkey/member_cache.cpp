@@ -0,0 +1,80 @@
+#include "member_cache.hpp"
+#include "vtable.hpp"
+
+#include <cstdint>
+
+namespace donkey{
+
+namespace{
+
+enum{
+	global_cache_size = 256, //power of two
+};
+
+//direct mapped on (vtable, name); a thread clears its copy when it falls behind member_cache_epoch()
+struct global_cache{
+	struct entry{
+		const vtable* vt;
+		atom name;
+		member_info member;
+	};
+
+	entry entries[global_cache_size];
+	size_t epoch;
+};
+
+global_cache& get_global_cache(size_t epoch){
+	static thread_local global_cache ret;
+
+	if(ret.epoch != epoch){
+		for(global_cache::entry& e: ret.entries){
+			e.vt = nullptr;
+		}
+		ret.epoch = epoch;
+	}
+	return ret;
+}
+
+size_t global_slot(const vtable* vt, atom name){
+	size_t h = (reinterpret_cast<uintptr_t>(vt) >> 4) ^ (reinterpret_cast<uintptr_t>(name) >> 3) * 31;
+	return (h ^ (h >> 8)) & (global_cache_size - 1);
+}
+
+}//namespace
+
+member_cache_stats get_member_cache_stats(){
+	return member_cache_counters();
+}
+
+void invalidate_member_caches(){
+	member_cache_epoch().fetch_add(1, std::memory_order_acq_rel);
+}
+
+member_info member_cache::find_slow(const vtable* vt, atom name){
+	member_cache_stats& counters = member_cache_counters();
+	size_t epoch = member_cache_epoch().load(std::memory_order_acquire);
+	if(_epoch != epoch){
+		_size = 0;
+		_epoch = epoch;
+	}
+	global_cache::entry& e = get_global_cache(epoch).entries[global_slot(vt, name)];
+
+	if(e.vt == vt && e.name == name){
+		++counters.global_hits;
+	}else{
+		++counters.misses;
+		const member_info* member = vt->find_member(name);
+		e.vt = vt;
+		e.name = name;
+		e.member = member ? *member : member_info{nullptr, size_t(-1)};
+	}
+
+	if(_size != size){
+		_entries[_size].vt = vt;
+		_entries[_size].member = e.member;
+		++_size;
+	}
+	return e.member;
+}
+
+}//donkey
@@ -0,0 +1,77 @@
+#ifndef __member_cache_hpp__
+#define __member_cache_hpp__
+
+#include <cstddef>
+#include <atomic>
+
+#include "donkey.hpp"
+#include "function.hpp"
+#include "atoms.hpp"
+
+namespace donkey{
+
+class vtable;
+
+struct member_info{
+	method* m; //nullptr for fields
+	size_t field; //size_t(-1) for methods and missing members
+};
+
+//counted on this thread
+member_cache_stats get_member_cache_stats();
+
+//drops the entries of all caches, on all threads; called when a vtable changes or dies
+void invalidate_member_caches();
+
+//caches filled before the last invalidation are stale
+inline std::atomic<size_t>& member_cache_epoch(){
+	static std::atomic<size_t> ret(0);
+	return ret;
+}
+
+inline member_cache_stats& member_cache_counters(){
+	static thread_local member_cache_stats ret = {0, 0, 0};
+	return ret;
+}
+
+//polymorphic cache of one call site; classes seen after it fills up go to the megamorphic cache
+class member_cache{
+	member_cache(const member_cache&) = delete;
+	void operator=(const member_cache&) = delete;
+public:
+	enum{
+		size = 4,
+	};
+private:
+	struct entry{
+		const vtable* vt;
+		member_info member;
+	};
+
+	entry _entries[size];
+	size_t _size;
+	size_t _epoch;
+
+	member_info find_slow(const vtable* vt, atom name);
+public:
+	member_cache():
+		_size(0),
+		_epoch(0){
+	}
+
+	member_info find(const vtable* vt, atom name){
+		if(_epoch == member_cache_epoch().load(std::memory_order_acquire)){
+			for(size_t i = 0; i != _size; ++i){
+				if(_entries[i].vt == vt){
+					++member_cache_counters().hits;
+					return _entries[i].member;
+				}
+			}
+		}
+		return find_slow(vt, name);
+	}
+};
+
+}//donkey
+
+#endif /*__member_cache_hpp__*/
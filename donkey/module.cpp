@@ -1,4 +1,5 @@
 #include "module.hpp"
+#include "call_stack.hpp"
 
 namespace donkey{
 
@@ -10,23 +11,44 @@ module::module(statement&& s,
 	           std::unordered_map<std::string, vtable_ptr>&& vtables,
 	           std::unordered_map<std::string, size_t>&& public_functions,
 	           std::unordered_map<std::string, size_t>&& public_globals,
-	           std::unordered_map<std::string, identifier_ptr>&& public_constants):
+	           std::unordered_map<std::string, identifier_ptr>&& public_constants,
+	           program_ptr code,
+	           std::unique_ptr<arena> nodes,
+	           std::vector<program_ptr>&& programs,
+	           std::vector<std::string>&& inlined_calls,
+	           size_t counted_loops):
+	_nodes(std::move(nodes)),
 	_functions(std::move(functions)),
 	_vtables(std::move(vtables)),
 	_s(std::move(s)),
+	_code(code),
+	_programs(std::move(programs)),
 	_module_name(std::move(module_name)),
 	_module_index(module_index),
 	_globals_count(globals_count),
 	_public_functions(std::move(public_functions)),
 	_public_globals(std::move(public_globals)),
-	_public_constants(std::move(public_constants)){
+	_public_constants(std::move(public_constants)),
+	_inlined_calls(std::move(inlined_calls)),
+	_counted_loops(counted_loops){
 }
 
 void module::load(runtime_context& ctx){
-	try{
+	//calls by name go straight to their targets once every function of the module exists
+	for(const program_ptr& p: _programs){
+		p->link(ctx);
+	}
+	if(_code){
+		_code->link(ctx);
+	}
+	
+	std::string name = _module_name + "::(global)";
+	call_stack_frame frame(name);
+	
+	if(_code){
+		_code->run(ctx);
+	}else{
 		_s(ctx);
-	}catch(const runtime_exception& e){
-		e.add_stack_trace(_module_name + "::(global)");
 	}
 }
 	
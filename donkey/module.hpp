@@ -4,7 +4,10 @@
 #include "function.hpp"
 #include "runtime_context.hpp"
 #include "statements.hpp"
+#include "vm.hpp"
 #include "identifiers.hpp"
+#include "arena.hpp"
+#include <memory>
 
 namespace donkey{
 
@@ -12,9 +15,13 @@ class module final: public identifier_lookup{
 	module(const module&) = delete;
 	void operator=(const module&) = delete;
 private:
+	//declared first, so the nodes outlive everything that points to them
+	std::unique_ptr<arena> _nodes;
 	std::vector<function> _functions;
 	std::unordered_map<std::string, vtable_ptr> _vtables;
 	statement _s;
+	program_ptr _code;
+	std::vector<program_ptr> _programs;
 	std::string _module_name;
 	size_t _module_index;
 	size_t _globals_count;
@@ -24,6 +31,9 @@ private:
 	
 	std::unordered_map<std::string, identifier_ptr> _public_constants;
 	
+	std::vector<std::string> _inlined_calls;
+	size_t _counted_loops;
+	
 public:
 	module(statement&& s,
 	       std::string module_name,
@@ -33,10 +43,25 @@ public:
 	       std::unordered_map<std::string, vtable_ptr>&& vtables,
 	       std::unordered_map<std::string, size_t>&& public_functions,
 	       std::unordered_map<std::string, size_t>&& public_globals,
-	       std::unordered_map<std::string, identifier_ptr>&& public_constants);
+	       std::unordered_map<std::string, identifier_ptr>&& public_constants,
+	       program_ptr code = program_ptr(),
+	       std::unique_ptr<arena> nodes = std::unique_ptr<arena>(),
+	       std::vector<program_ptr>&& programs = std::vector<program_ptr>(),
+	       std::vector<std::string>&& inlined_calls = std::vector<std::string>(),
+	       size_t counted_loops = 0);
 	       
 	void load(runtime_context& ctx);
 	
+	//"caller: callee" for each call site where the callee was inlined
+	const std::vector<std::string>& get_inlined_calls() const{
+		return _inlined_calls;
+	}
+	
+	//for loops whose step and condition became one instruction
+	size_t get_counted_loops() const{
+		return _counted_loops;
+	}
+	
 	size_t get_globals_count() const{
 		return _globals_count;
 	}
@@ -45,6 +70,10 @@ public:
 		return _functions[idx](ctx, prms);
 	}
 	
+	const function& get_function(size_t idx) const{
+		return _functions[idx];
+	}
+	
 	vtable* get_vtable(std::string name) const{
 		auto it = _vtables.find(name);
 		return it == _vtables.end() ? nullptr : it->second.get();
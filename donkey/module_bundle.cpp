@@ -1,4 +1,5 @@
 #include "module_bundle.hpp"
+#include "collector.hpp"
 
 #include <algorithm>
 
@@ -43,8 +44,11 @@ void module_bundle::add_module(std::string name, module_ptr m){
 void module_bundle::unload_from(size_t idx){
 	for(size_t i = idx; i < _modules.size(); ++i){
 		if(_modules[i]){
+			//what is still queued is destroyed while the globals its destructors read are alive
+			flush_deferred_releases();
 			for(size_t j = _modules[i]->get_globals_count(); j; --j){
 				_globals[i][j-1].reset();
+				flush_deferred_releases();
 			}
 			delete[] _globals[i];
 			_modules[i].reset();
@@ -68,8 +72,10 @@ void module_bundle::unload_from(size_t idx){
 
 module_bundle::~module_bundle(){
 	for(size_t i = 0; i < _modules.size(); ++i){
+		flush_deferred_releases();
 		for(size_t j = _modules[i]->get_globals_count(); j; --j){
 			_globals[i][j-1].reset();
+			flush_deferred_releases();
 		}
 		delete[] _globals[i];
 	}
@@ -35,6 +35,10 @@ public:
 		return _modules[addr.get_module_index()]->call_function_by_index(addr.get_function_index(), *this, params_size);
 	}
 	
+	const function& get_function(code_address addr) const{
+		return _modules[addr.get_module_index()]->get_function(addr.get_function_index());
+	}
+	
 	variable& global(uint32_t module_idx, uint32_t var_idx){
 		return _globals[module_idx][var_idx];
 	}
@@ -0,0 +1,424 @@
+#include "module_cache.hpp"
+#include "atoms.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace donkey{
+
+namespace{
+
+const char magic[4] = {'D', 'K', 'Y', 'C'};
+
+enum{
+	version = 3, //to be raised whenever the layout of programs changes
+};
+
+enum class constant_type: uint8_t{
+	nothing,
+	number,
+	string,
+	code_address,
+};
+
+uint64_t hash(const void* data, size_t size, uint64_t h = 14695981039346656037ull){
+	const unsigned char* p = static_cast<const unsigned char*>(data);
+	for(size_t i = 0; i != size; ++i){
+		h = (h ^ p[i]) * 1099511628211ull;
+	}
+	return h;
+}
+
+template<typename T>
+uint64_t hash_value(const T& t, uint64_t h){
+	return hash(&t, sizeof(T), h);
+}
+
+uint64_t hash_string(const std::string& s, uint64_t h){
+	return hash(s.data(), s.size(), hash_value(s.size(), h));
+}
+
+//a program written by another build of the interpreter is never trusted
+uint64_t build_key(const std::string& name, size_t index){
+	uint64_t h = hash_value(uint32_t(version), hash(magic, sizeof(magic)));
+	h = hash_value(uint32_t(vm_op::count), h);
+	h = hash_value(uint32_t(sizeof(instruction)), h);
+	h = hash_value(uint32_t(sizeof(size_t)), h);
+	return hash_value(uint64_t(index), hash_string(name, h));
+}
+
+}//anonymous namespace
+
+class module_cache::writer{
+private:
+	std::vector<char>& _data;
+public:
+	explicit writer(std::vector<char>& data):
+		_data(data){
+	}
+
+	template<typename T>
+	void put(const T& t){
+		const char* p = reinterpret_cast<const char*>(&t);
+		_data.insert(_data.end(), p, p + sizeof(T));
+	}
+
+	void put_string(const std::string& s){
+		put(uint32_t(s.size()));
+		_data.insert(_data.end(), s.begin(), s.end());
+	}
+
+	//for vectors of types without padding
+	template<typename T>
+	void put_vector(const std::vector<T>& v){
+		put(uint32_t(v.size()));
+		const char* p = reinterpret_cast<const char*>(v.data());
+		_data.insert(_data.end(), p, p + v.size() * sizeof(T));
+	}
+};
+
+//a failed read leaves zeros, and the whole file is dropped once it is over
+class module_cache::reader{
+private:
+	const char* _p;
+	const char* _end;
+	bool _ok;
+public:
+	reader(const char* begin, const char* end):
+		_p(begin),
+		_end(end),
+		_ok(true){
+	}
+
+	explicit operator bool() const{
+		return _ok;
+	}
+
+	bool at_end() const{
+		return _p == _end;
+	}
+
+	void fail(){
+		_ok = false;
+		_p = _end;
+	}
+
+	template<typename T>
+	T get(){
+		T t = T();
+		if(size_t(_end - _p) < sizeof(T)){
+			fail();
+		}else{
+			memcpy(&t, _p, sizeof(T));
+			_p += sizeof(T);
+		}
+		return t;
+	}
+
+	//number of elements of sz bytes that follows, or 0 if there cannot be that many
+	size_t get_count(size_t sz){
+		size_t n = get<uint32_t>();
+		if(n > size_t(_end - _p) / sz){
+			fail();
+			return 0;
+		}
+		return n;
+	}
+
+	std::string get_string(){
+		size_t n = get_count(1);
+		std::string ret(_p, n);
+		_p += n;
+		return ret;
+	}
+
+	template<typename T>
+	void get_vector(std::vector<T>& v){
+		size_t n = get_count(sizeof(T));
+		v.resize(n);
+		if(n){
+			memcpy(v.data(), _p, n * sizeof(T));
+			_p += n * sizeof(T);
+		}
+	}
+};
+
+uint64_t module_cache::module_key(const std::string& name, size_t index, const std::vector<char>& source, const std::vector<uint64_t>& imports){
+	uint64_t h = hash(source.data(), source.size(), build_key(name, index));
+	for(uint64_t i: imports){
+		h = hash_value(i, h);
+	}
+	return h;
+}
+
+uint64_t module_cache::module_key(const std::string& name, size_t index, const identifier_lookup& m){
+	//what a donkey module compiles against; sorted, as the order of the public identifiers is not fixed
+	std::vector<std::string> ids;
+	for(const identifier_ptr& id: m.get_all_public()){
+		std::string s(1, char(id->get_type()));
+		s += id->get_name();
+		s += '\0';
+		switch(id->get_type()){
+			case identifier_type::global_variable:
+				s += std::to_string(static_cast<global_variable_identifier&>(*id).get_var_index());
+				break;
+			case identifier_type::function:
+				s += std::to_string(static_cast<function_identifier&>(*id).get_function().get_function_index());
+				break;
+			case identifier_type::number:{
+				number n = static_cast<number_constant_identifier&>(*id).get_number();
+				s.append(reinterpret_cast<const char*>(&n), sizeof(n));
+				break;
+			}
+			case identifier_type::string:
+				s += static_cast<string_constant_identifier&>(*id).get_string();
+				break;
+			default:
+				break;
+		}
+		ids.push_back(std::move(s));
+	}
+	std::sort(ids.begin(), ids.end());
+
+	uint64_t h = build_key(name, index);
+	for(const std::string& s: ids){
+		h = hash_string(s, h);
+	}
+	return h;
+}
+
+bool module_cache::can_save(const program& p){
+	if(!p._expressions.empty() || !p._statements.empty()){
+		return false;
+	}
+	for(const variable& v: p._constants){
+		var_type vt = v.get_var_type();
+		if(vt != var_type::nothing && vt != var_type::number && vt != var_type::code_address && !is_string(vt)){
+			return false;
+		}
+	}
+	return true;
+}
+
+void module_cache::add(const std::string& name, size_t params_count, size_t end, const program_ptr& code){
+	if(!_loaded && code && can_save(*code)){
+		_functions[name] = entry{params_count, end, code};
+	}
+}
+
+void module_cache::save_program(writer& w, const program& p){
+	w.put(uint64_t(p._frame_size));
+	w.put_vector(p._code);
+
+	w.put(uint32_t(p._constants.size()));
+	for(const variable& v: p._constants){
+		switch(v.get_var_type()){
+			case var_type::nothing:
+				w.put(constant_type::nothing);
+				break;
+			case var_type::number:
+				w.put(constant_type::number);
+				w.put(v.as_number_unsafe());
+				break;
+			case var_type::code_address:
+				w.put(constant_type::code_address);
+				w.put(uint32_t(v.as_code_address_unsafe().get_module_index()));
+				w.put(uint32_t(v.as_code_address_unsafe().get_function_index()));
+				break;
+			default:
+				w.put(constant_type::string);
+				w.put_string(std::string(v.as_string_unsafe(), v.string_length_unsafe()));
+				break;
+		}
+	}
+
+	w.put(uint32_t(p._switches.size()));
+	for(const number_switch& s: p._switches){
+		w.put(s._min);
+		w.put(s._dflt);
+		w.put_vector(s._dense);
+		w.put(uint32_t(s._sparse.size()));
+		for(const auto& c: s._sparse){
+			w.put(c.first);
+			w.put(c.second);
+		}
+	}
+
+	w.put(uint32_t(p._string_switches.size()));
+	for(const string_switch& s: p._string_switches){
+		w.put(s._seed);
+		w.put(uint32_t(s._shift));
+		w.put(s._dflt);
+		w.put_vector(s._slots);
+		w.put(uint32_t(s._entries.size()));
+		for(const string_switch::entry& e: s._entries){
+			w.put_string(e.s);
+			w.put(e.hash);
+			w.put(e.target);
+		}
+	}
+
+	w.put(uint32_t(p._callees.size()));
+	for(const callee& c: p._callees){
+		w.put(uint32_t(c.address.get_module_index()));
+		w.put(uint32_t(c.address.get_function_index()));
+	}
+
+	w.put(uint32_t(p._inlined.size()));
+	for(const std::string& s: p._inlined){
+		w.put_string(s);
+	}
+	w.put_vector(p._inlined_outer);
+}
+
+program_ptr module_cache::load_program(reader& r){
+	std::shared_ptr<program> p(new program());
+
+	p->_frame_size = size_t(r.get<uint64_t>());
+	r.get_vector(p->_code);
+	for(const instruction& i: p->_code){
+		if(uint32_t(i.op) >= uint32_t(vm_op::count)){
+			r.fail();
+		}
+	}
+
+	for(size_t n = r.get_count(1); n; --n){
+		switch(r.get<constant_type>()){
+			case constant_type::nothing:
+				p->_constants.push_back(variable());
+				break;
+			case constant_type::number:
+				p->_constants.push_back(variable(r.get<number>()));
+				break;
+			case constant_type::code_address:{
+				uint32_t m = r.get<uint32_t>();
+				p->_constants.push_back(variable(code_address::create(m, r.get<uint32_t>())));
+				break;
+			}
+			case constant_type::string:
+				p->_constants.push_back(get_string_constant(get_atom(r.get_string())));
+				break;
+			default:
+				r.fail();
+				break;
+		}
+	}
+
+	for(size_t n = r.get_count(1); n; --n){
+		number_switch s;
+		s._min = r.get<number>();
+		s._dflt = r.get<int32_t>();
+		r.get_vector(s._dense);
+		for(size_t c = r.get_count(sizeof(number) + sizeof(int32_t)); c; --c){
+			number value = r.get<number>();
+			s._sparse.emplace_back(value, r.get<int32_t>());
+		}
+		p->_switches.push_back(std::move(s));
+	}
+
+	for(size_t n = r.get_count(1); n; --n){
+		string_switch s;
+		s._seed = r.get<uint32_t>();
+		s._shift = r.get<uint32_t>();
+		s._dflt = r.get<int32_t>();
+		r.get_vector(s._slots);
+		for(size_t c = r.get_count(1); c; --c){
+			std::string str = r.get_string();
+			uint32_t h = r.get<uint32_t>();
+			s._entries.push_back(string_switch::entry{std::move(str), h, r.get<int32_t>()});
+		}
+		if(s._slots.empty() || s._slots.back() != s._entries.size()){
+			r.fail();
+		}
+		p->_string_switches.push_back(std::move(s));
+	}
+
+	for(size_t n = r.get_count(1); n; --n){
+		uint32_t m = r.get<uint32_t>();
+		p->_callees.push_back(callee{code_address::create(m, r.get<uint32_t>()), nullptr, nullptr});
+	}
+
+	for(size_t n = r.get_count(1); n; --n){
+		p->_inlined.push_back(r.get_string());
+	}
+	r.get_vector(p->_inlined_outer);
+	if(p->_inlined_outer.size() != p->_inlined.size()){
+		r.fail();
+	}
+	for(size_t i = 0; i != p->_inlined_outer.size(); ++i){
+		if(p->_inlined_outer[i] < -1 || p->_inlined_outer[i] >= int32_t(i)){
+			r.fail();
+		}
+	}
+	for(const instruction& i: p->_code){
+		if((i.op == vm_op::enter_inline || i.op == vm_op::leave_inline) && size_t(i.a) >= p->_inlined.size()){
+			r.fail();
+		}
+	}
+	p->link_inlined_frames();
+
+	return p;
+}
+
+std::vector<char> module_cache::save() const{
+	std::vector<char> body;
+	writer w(body);
+
+	w.put(uint32_t(_functions.size()));
+	for(const auto& p: _functions){
+		w.put_string(p.first);
+		w.put(uint64_t(p.second.params_count));
+		w.put(uint64_t(p.second.end));
+		save_program(w, *p.second.code);
+	}
+
+	std::vector<char> ret;
+	writer header(ret);
+	for(char c: magic){
+		header.put(c);
+	}
+	header.put(_key);
+	header.put(hash(body.data(), body.size()));
+	ret.insert(ret.end(), body.begin(), body.end());
+	return ret;
+}
+
+bool module_cache::load(const std::vector<char>& data){
+	size_t header = sizeof(magic) + 2 * sizeof(uint64_t);
+	if(data.size() < header){
+		return false;
+	}
+
+	reader r(data.data(), data.data() + data.size());
+
+	for(char c: magic){
+		if(r.get<char>() != c){
+			return false;
+		}
+	}
+	if(r.get<uint64_t>() != _key){
+		return false;
+	}
+	if(r.get<uint64_t>() != hash(data.data() + header, data.size() - header)){
+		return false;
+	}
+
+	std::unordered_map<std::string, entry> functions;
+	for(size_t n = r.get_count(1); n; --n){
+		std::string name = r.get_string();
+		size_t params_count = size_t(r.get<uint64_t>());
+		size_t end = size_t(r.get<uint64_t>());
+		program_ptr code = load_program(r);
+		functions[name] = entry{params_count, end, code};
+	}
+
+	if(!r || !r.at_end()){
+		return false;
+	}
+
+	_functions = std::move(functions);
+	_loaded = true;
+	return true;
+}
+
+}//donkey
@@ -0,0 +1,65 @@
+#ifndef __module_cache_hpp__
+#define __module_cache_hpp__
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "vm.hpp"
+#include "identifiers.hpp"
+
+namespace donkey{
+
+//function bodies of a donkey module lowered entirely to bytecode, kept in <module>.dkyc next to its source;
+//only read back for the same source, module index, imports and interpreter it was written with
+class module_cache{
+public:
+	struct entry{
+		size_t params_count;
+		size_t end; //offset just past the closing brace of the body
+		program_ptr code;
+	};
+private:
+	uint64_t _key;
+	bool _loaded;
+	std::unordered_map<std::string, entry> _functions;
+
+	class writer;
+	class reader;
+
+	static bool can_save(const program& p);
+	static void save_program(writer& w, const program& p);
+	static program_ptr load_program(reader& r);
+public:
+	explicit module_cache(uint64_t key):
+		_key(key),
+		_loaded(false){
+	}
+
+	static uint64_t module_key(const std::string& name, size_t index, const std::vector<char>& source, const std::vector<uint64_t>& imports);
+
+	//native modules, by their public identifiers
+	static uint64_t module_key(const std::string& name, size_t index, const identifier_lookup& m);
+
+	//true if the functions were read back from the data; they are only looked up then
+	bool load(const std::vector<char>& data);
+
+	bool is_loaded() const{
+		return _loaded;
+	}
+
+	std::vector<char> save() const;
+
+	const entry* find(const std::string& name, size_t params_count) const{
+		auto it = _functions.find(name);
+		return it != _functions.end() && it->second.params_count == params_count ? &it->second : nullptr;
+	}
+
+	//ignored for bodies that still run trees, which only exist in this run
+	void add(const std::string& name, size_t params_count, size_t end, const program_ptr& code);
+};
+
+}//donkey
+
+#endif /*__module_cache_hpp__*/
@@ -91,6 +91,7 @@ vtable_ptr vector_vt(){
 		);
 			
 		vt->derive_from(*object_vtable());
+		vt->set_traverser(&traverse_native<vector>);
 		return vt;
 	}());
 	
@@ -141,6 +142,7 @@ vtable_ptr deque_vt(){
 		);
 			
 		vt->derive_from(*object_vtable());
+		vt->set_traverser(&traverse_native<deque>);
 		return vt;
 	}());
 	
@@ -191,6 +193,7 @@ vtable_ptr list_vt(){
 		);
 			
 		vt->derive_from(*object_vtable());
+		vt->set_traverser(&traverse_native<list>);
 		return vt;
 	}());
 	
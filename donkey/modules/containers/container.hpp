@@ -69,7 +69,7 @@ public:
 	variable post_inc(){
 		auto it = _it;
 		pre_inc();
-		return variable(new iterator(_container, it));
+		return variable::create_native<iterator>(_container, it);
 	}
 	
 	void pre_dec(){
@@ -81,7 +81,7 @@ public:
 	variable post_dec(){
 		auto it = _it;
 		pre_dec();
-		return variable(new iterator(_container, it));
+		return variable::create_native<iterator>(_container, it);
 	}
 	
 	integer diff(ThisType* oth){
@@ -93,7 +93,7 @@ public:
 	variable add(integer n){
 		check_deleted();
 		
-		variable ret(new iterator(_container, _it));
+		variable ret = variable::create_native<iterator>(_container, _it);
 		
 		ret.as_t_unsafe<ThisType>()->advance(n);
 		
@@ -226,6 +226,12 @@ public:
 		return container_virtual_tables<T>::main();
 	}
 	
+	void traverse(const child_visitor& visit){
+		for(variable& v: _data){
+			visit(v);
+		}
+	}
+	
 	variable get_item(integer idx){
 		if(idx < 0 || idx >= integer(_data.size())){
 			runtime_error("subscript out of range");
@@ -328,18 +334,18 @@ public:
 	
 	static variable create(runtime_context& ctx, size_t sz){
 		if(sz == 0){
-			return variable(new ThisType());
+			return variable::create_native<ThisType>();
 		}
 		
 		variable& v = ctx.top();
 		
 		if(v.get_data_type() == var_type::number){
-			return variable(new ThisType(size_t(v.as_integer())));
+			return variable::create_native<ThisType>(size_t(v.as_integer()));
 		}
 		
 		if(v.get_vtable() == array_vtable().get()){
 			auto data = get_array_data_unsafe(v);
-			return variable(new ThisType(data.first, data.second));
+			return variable::create_native<ThisType>(data.first, data.second);
 		}
 		
 		runtime_error("number or array expected");
@@ -348,11 +354,11 @@ public:
 	}
 	
 	static variable begin(const variable& that, runtime_context&, size_t){
-		return variable(new iterator<T>(that, that.as_t_unsafe<ThisType>()->_data.begin()));
+		return variable::create_native<iterator<T> >(that, that.as_t_unsafe<ThisType>()->_data.begin());
 	}
 	
 	static variable end(const variable& that, runtime_context&, size_t){
-		return variable(new iterator<T>(that, that.as_t_unsafe<ThisType>()->_data.end()));
+		return variable::create_native<iterator<T> >(that, that.as_t_unsafe<ThisType>()->_data.end());
 	}
 	
 	static std::string full_type_name(){
@@ -70,7 +70,7 @@ public:
 	}
 	
 	variable get_item(integer idx){
-		return variable(new placeholder(size_t(idx)));
+		return variable::create_native<placeholder>(size_t(idx));
 	}
 	
 	vtable* get_vtable(){
@@ -133,7 +133,7 @@ module_ptr load_functional_module(size_t module_idx){
 	m.set_init([module_idx, placeholders_idx](runtime_context& ctx){
 		variable& v_placeholders = global_variable(ctx, module_idx, placeholders_idx);
 	
-		v_placeholders = variable(new placeholders());
+		v_placeholders = variable::create_native<placeholders>();
 		
 		return statement_retval::nxt;
 	});
@@ -70,7 +70,7 @@ public:
 static statement_retval init_io(runtime_context& ctx, size_t module_idx, size_t console_idx){
 	variable& v_console = global_variable(ctx, module_idx, console_idx);
 	
-	v_console = variable(new console());
+	v_console = variable::create_native<console>();
 	
 	return statement_retval::nxt;
 }
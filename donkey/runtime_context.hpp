@@ -5,7 +5,7 @@
 #include <memory>
 #include <functional>
 #include <cstdint>
-#include <set>
+#include <algorithm>
 
 #include "variables.hpp"
 #include "stack.hpp"
@@ -14,7 +14,7 @@ namespace donkey{
 
 class runtime_context{
 	friend class stack_pusher;
-	friend class stack_remover;
+	friend class extra_params_mover;
 	friend class constructor_stack_manipulator;
 	friend class function_stack_manipulator;
 	
@@ -25,7 +25,8 @@ private:
 	size_t _function_stack_bottom;
 	size_t _retval_stack_index;
 	const variable* _that;
-	std::set<std::string>* _constructed;
+	std::vector<size_t>* _constructed; //class ids
+	std::vector<variable> _tail_params; //of the pending tail call; keeps its capacity
 
 	void push_default(size_t cnt){
 		_stack.add_size(cnt);
@@ -47,16 +48,10 @@ private:
 		return _stack.size();
 	}
 	
-	void store_stack(std::vector<variable>& vs, size_t cnt){
-		for(size_t i = 0; i < cnt; ++i){
-			vs.push_back(std::move(_stack.top(i)));
-		}
-		_stack.pop(cnt);
-	}
-	void restore_stack(std::vector<variable>& vs){
-		for(size_t i = vs.size(); i > 0; --i){
-			_stack.push(std::move(vs[i-1]));
-		}
+	//of the top size variables, moves the top cnt below the others; no copies and no allocation
+	void rotate_stack(size_t size, size_t cnt){
+		variable* last = &_stack.top(0) + 1;
+		std::rotate(last - size, last - cnt, last);
 	}
 public:
 	runtime_context(size_t stack_size):
@@ -78,26 +73,30 @@ public:
 	void set_retval(variable&& v){
 		_stack[_retval_stack_index] = std::move(v);
 	}
+	
+	std::vector<variable>& tail_params(){
+		return _tail_params;
+	}
 
 	
 	const variable* that(){
 		return _that;
 	}
 	
-	bool is_constructed(const std::string& str) const{
-		return _constructed->find(str) != _constructed->end();
+	bool is_constructed(size_t class_id) const{
+		return std::find(_constructed->begin(), _constructed->end(), class_id) != _constructed->end();
 	}
 	
-	bool is_destroyed(const std::string& str) const{
-		return is_constructed(str);
+	bool is_destroyed(size_t class_id) const{
+		return is_constructed(class_id);
 	}
 	
-	void set_constructed(const std::string& str) const{
-		_constructed->insert(str);
+	void set_constructed(size_t class_id) const{
+		_constructed->push_back(class_id);
 	}
 	
-	void set_destroyed(const std::string& str) const{
-		set_constructed(str);
+	void set_destroyed(size_t class_id) const{
+		set_constructed(class_id);
 	}
 };
 
@@ -129,24 +128,50 @@ public:
 	}
 };
 
-class stack_remover{
-	stack_remover(const stack_remover&) = delete;
-	void operator=(const stack_remover&) = delete;
+//the arguments of a tail call are pending while the frame that made it is torn down;
+//a function called by a destructor there gets the vector to itself
+class tail_params_saver{
+	tail_params_saver(const tail_params_saver&) = delete;
+	void operator=(const tail_params_saver&) = delete;
 private:
-	std::vector<variable> _removed;
 	runtime_context& _ctx;
+	std::vector<variable> _params;
 public:
-	stack_remover(runtime_context& ctx, size_t remove_cnt):
+	tail_params_saver(runtime_context& ctx):
 		_ctx(ctx){
-		if(remove_cnt){
-			_removed.reserve(remove_cnt);
-			_ctx.store_stack(_removed, remove_cnt);
+		if(!ctx.tail_params().empty()){
+			_params.swap(ctx.tail_params());
+		}
+	}
+	
+	~tail_params_saver(){
+		if(!_params.empty()){
+			_params.swap(_ctx.tail_params());
+		}
+	}
+};
+
+//params passed beyond the expected ones are moved below the others for the duration of the call
+class extra_params_mover{
+	extra_params_mover(const extra_params_mover&) = delete;
+	void operator=(const extra_params_mover&) = delete;
+private:
+	runtime_context& _ctx;
+	size_t _passed;
+	size_t _extra;
+public:
+	extra_params_mover(runtime_context& ctx, size_t expected_params, size_t passed_params):
+		_ctx(ctx),
+		_passed(passed_params),
+		_extra(expected_params < passed_params ? passed_params - expected_params : 0){
+		if(_extra){
+			_ctx.rotate_stack(_passed, _extra);
 		}
 	}
 	
-	~stack_remover(){
-		if(_removed.size()){
-			_ctx.restore_stack(_removed);
+	~extra_params_mover(){
+		if(_extra){
+			_ctx.rotate_stack(_passed, _passed - _extra);
 		}
 	}
 };
@@ -155,8 +180,8 @@ class constructor_stack_manipulator{
 	constructor_stack_manipulator(const constructor_stack_manipulator&) = delete;
 	void operator=(const constructor_stack_manipulator&) = delete;
 private:
-	std::set<std::string> _constructed;
-	std::set<std::string>* _old_constructed;
+	std::vector<size_t> _constructed;
+	std::vector<size_t>* _old_constructed;
 	runtime_context& _ctx;
 public:
 	constructor_stack_manipulator(runtime_context& ctx):
@@ -175,7 +200,7 @@ class function_stack_manipulator{
 	function_stack_manipulator(const function_stack_manipulator&) = delete;
 	void operator=(const function_stack_manipulator&) = delete;
 private:
-	stack_remover _remover;
+	extra_params_mover _mover;
 	stack_pusher _pusher;
 	runtime_context& _ctx;
 	size_t _function_stack_bottom;
@@ -183,7 +208,7 @@ private:
 	const variable* _that;
 public:
 	function_stack_manipulator(runtime_context& ctx, size_t expected_params, size_t passed_params, const variable* that = nullptr):
-		_remover(ctx, expected_params < passed_params ? passed_params - expected_params : 0),
+		_mover(ctx, expected_params, passed_params),
 		_pusher(ctx, expected_params > passed_params ? expected_params - passed_params + 1 : 1),
 		_ctx(ctx),
 		_function_stack_bottom(ctx._function_stack_bottom),
@@ -210,6 +235,8 @@ public:
 
 variable call_function_by_address(code_address addr, runtime_context& ctx, size_t params_size);
 
+const function& function_by_address(code_address addr, runtime_context& ctx);
+
 variable& global_variable(runtime_context& ctx, uint32_t module_index, uint32_t var_index);
 
 }//namespace donkey
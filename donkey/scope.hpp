@@ -10,9 +10,13 @@
 #include "vtable.hpp"
 #include "tokenizer.hpp"
 #include "module_bundle.hpp"
+#include "arena.hpp"
 
 namespace donkey{
 
+struct lazy_module;
+class module_cache;
+
 class scope: public identifier_lookup{
 private:
 	std::unordered_map<std::string, identifier_ptr> _usings;
@@ -21,6 +25,7 @@ private:
 	std::unordered_map<std::string, identifier_ptr> _constants;
 	std::unordered_map<std::string, identifier_ptr> _public_constants;
 	std::vector<statement> _statements;
+	std::vector<local_info*> _locals;
 	scope* _parent;
 	int _var_index;
 	size_t _module_index;
@@ -124,14 +129,27 @@ public:
 		return _can_continue;
 	}
 	
-	void add_variable(std::string name, bool is_public){
+	//locals are collected by the scope that owns the frame, which is the function or the module
+	local_info* new_local(){
+		if(_is_function || is_global()){
+			_locals.push_back(new_node<local_info>());
+			return _locals.back();
+		}
+		return _parent->new_local();
+	}
+	
+	void infer_local_types(){
+		infer_numeric_locals(_locals);
+	}
+	
+	void add_variable(std::string name, bool is_public, local_info* info = nullptr){
 		if(is_public){
 			_public_variables[name] = _var_index;
 		}
 		if(is_global()){
 			_variables[name].reset(new global_variable_identifier(name, _module_index, _var_index++));
 		}else{
-			_variables[name].reset(new local_variable_identifier(name, _var_index++));
+			_variables[name].reset(new local_variable_identifier(name, _var_index++, info ? info : new_local()));
 		}
 	}
 	
@@ -188,6 +206,19 @@ public:
 		return _parent->get_module_name();
 	}
 	
+	virtual execution_mode get_execution_mode() const{
+		return _parent->get_execution_mode();
+	}
+	
+	virtual void add_program(const program_ptr& p){
+		_parent->add_program(p);
+	}
+	
+	//records what was inlined and specialized in a program compiled for caller
+	virtual void add_compiled(const std::string& caller, const program& p){
+		_parent->add_compiled(caller, p);
+	}
+	
 	std::unordered_map<std::string, size_t> get_public_vars() const{
 		return _public_variables;
 	}
@@ -218,16 +249,25 @@ private:
 	std::unordered_map<std::string, function_identifier_ptr> _functions;
 	std::vector<function> _definitions;
 	std::unordered_map<std::string, vtable_ptr> _vtables;
+	std::vector<program_ptr> _programs;
+	std::vector<std::string> _inlined_calls;
+	size_t _counted_loops;
 	std::string _module_name;
+	execution_mode _mode;
 	
 	std::unordered_map<std::string, size_t> _public_functions;
 	
 	std::unordered_map<std::string, identifier_ptr> _import;
+	
+	std::weak_ptr<lazy_module> _lazy;
+	std::shared_ptr<module_cache> _cache;
 public:
-	global_scope(module_bundle& bundle, std::string&& module_name, size_t module_index):
+	global_scope(module_bundle& bundle, std::string&& module_name, size_t module_index, execution_mode mode):
 		scope(module_index),
 		_bundle(bundle),
-		_module_name(module_name){
+		_counted_loops(0),
+		_module_name(module_name),
+		_mode(mode){
 	}
 	
 	bool import(std::string name, const module& m){
@@ -247,7 +287,7 @@ public:
 		if(_functions.find(name) != _functions.end()){
 			return;
 		}
-		_functions[name].reset(new function_identifier(name, code_address::create(get_module_index(), _definitions.size())));
+		_functions[name].reset(new function_identifier(name, code_address::create(get_module_index(), _definitions.size()), std::make_shared<inline_function>()));
 		if(is_public){
 			_public_functions[name] = _definitions.size();
 		}
@@ -260,11 +300,19 @@ public:
 		if(ptr){
 			_definitions[ptr->get_function().get_function_index()] = std::move(f);
 		}else{
-			ptr.reset(new function_identifier(name, code_address::create(get_module_index(), _definitions.size())));
+			ptr.reset(new function_identifier(name, code_address::create(get_module_index(), _definitions.size()), std::make_shared<inline_function>()));
 			_definitions.push_back(std::move(f));
 		}
 	}
 	
+	//lets the call sites compiled from now on inline the function
+	void set_inline_function(std::string name, expression_ptr e, size_t params_count, const std::string& full_name){
+		inline_function& f = *_functions[name]->get_inline();
+		f.e = e;
+		f.params_count = params_count;
+		f.name = full_name;
+	}
+	
 	std::string get_undefined_function() const{
 		for(const auto& p: _functions){
 			if(!_definitions[p.second->get_function().get_function_index()]){
@@ -278,8 +326,31 @@ public:
 		return std::move(_definitions);
 	}
 	
+	//copied, as function bodies compiled lazily still look classes up here
 	std::unordered_map<std::string, vtable_ptr> get_vtables(){
-		return std::move(_vtables);
+		return _vtables;
+	}
+	
+	//set when function bodies are to be compiled on their first call
+	void set_lazy_module(const std::shared_ptr<lazy_module>& m){
+		_lazy = m;
+	}
+	
+	std::shared_ptr<lazy_module> get_lazy_module() const{
+		return _lazy.lock();
+	}
+	
+	//set when function bodies are read from, or saved to, the module cache
+	void set_module_cache(const std::shared_ptr<module_cache>& cache){
+		_cache = cache;
+	}
+	
+	module_cache* get_module_cache() const{
+		return _cache.get();
+	}
+	
+	std::vector<program_ptr> get_programs(){
+		return std::move(_programs);
 	}
 	
 	virtual identifier_ptr get_identifier(std::string name) const override{
@@ -321,6 +392,29 @@ public:
 		return _module_name;
 	}
 	
+	virtual execution_mode get_execution_mode() const override{
+		return _mode;
+	}
+	
+	virtual void add_program(const program_ptr& p) override{
+		_programs.push_back(p);
+	}
+	
+	virtual void add_compiled(const std::string& caller, const program& p) override{
+		for(const std::string& callee: p.get_inlined()){
+			_inlined_calls.push_back(caller + ": " + callee);
+		}
+		_counted_loops += p.get_counted_loops();
+	}
+	
+	std::vector<std::string> get_inlined_calls(){
+		return std::move(_inlined_calls);
+	}
+	
+	size_t get_counted_loops() const{
+		return _counted_loops;
+	}
+	
 	std::unordered_map<std::string, size_t> get_public_functions() const{
 		return _public_functions;
 	}
@@ -3,11 +3,14 @@
 
 #include "runtime_context.hpp"
 #include "expressions.hpp"
+#include "switch_tables.hpp"
 #include <vector>
 #include <unordered_map>
 
 namespace donkey{
 
+class bytecode_builder;
+
 enum class statement_retval{
 	nxt,
 	brk,
@@ -34,6 +37,8 @@ public:
 	expression_statement(const expression_statement& orig):
 		_e(orig._e){
 	}
+	void lower(bytecode_builder& b) const;
+	
 	statement_retval operator()(runtime_context& ctx) const{
 		_e->as_void(ctx);
 		return statement_retval::nxt;
@@ -59,6 +64,8 @@ public:
 		_ss(ss),
 		_locals_count(locals_count){
 	}
+	void lower(bytecode_builder& b) const;
+	
 	statement_retval operator()(runtime_context& ctx) const{
 		stack_pusher pusher(ctx, _locals_count);
 		
@@ -89,6 +96,8 @@ public:
 	block_statement(std::vector<statement>&& ss):
 		_ss(ss){
 	}
+	void lower(bytecode_builder& b) const;
+	
 	statement_retval operator()(runtime_context& ctx) const{
 		for(const statement& s: _ss){
 			statement_retval r = s(ctx);
@@ -125,6 +134,8 @@ public:
 		_e3(e3),
 		_s(s){
 	}
+	void lower(bytecode_builder& b) const;
+	
 	statement_retval operator()(runtime_context& ctx) const{
 		for(_e1->as_void(ctx); _e2->as_bool(ctx); _e3->as_void(ctx)){
 			switch(_s(ctx)){
@@ -157,6 +168,8 @@ public:
 		_e(e),
 		_s(s){
 	}
+	void lower(bytecode_builder& b) const;
+	
 	statement_retval operator()(runtime_context& ctx) const{
 		while(_e->as_bool(ctx)){
 			switch(_s(ctx)){
@@ -189,6 +202,8 @@ public:
 		_e(e),
 		_s(s){
 	}
+	void lower(bytecode_builder& b) const;
+	
 	statement_retval operator()(runtime_context& ctx) const{
 		do{
 			switch(_s(ctx)){
@@ -222,6 +237,8 @@ public:
 		_ss(ss){
 	}
 	
+	void lower(bytecode_builder& b) const;
+	
 	statement_retval operator()(runtime_context& ctx) const{
 		for(size_t i = 0; i < _es.size(); ++i){
 			if(_es[i]->as_bool(ctx)){
@@ -250,6 +267,8 @@ public:
 		_s(std::move(s)){
 	}
 	
+	void lower(bytecode_builder& b) const;
+	
 	statement_retval operator()(runtime_context& ctx) const{
 		if(_e->as_bool(ctx)){
 			return _s(ctx);
@@ -280,12 +299,13 @@ public:
 		_else(std::move(els)){
 	}
 	
+	void lower(bytecode_builder& b) const;
+	
 	statement_retval operator()(runtime_context& ctx) const{
 		if(_e->as_bool(ctx)){
 			return _s(ctx);
 		}
-		_else(ctx);
-		return statement_retval::nxt;
+		return _else(ctx);
 	}
 };
 
@@ -293,41 +313,48 @@ class switch_statement{
 private:
 	expression_ptr _e;
 	std::vector<statement> _ss;
-	std::unordered_map<number, size_t> _cases;
-	size_t _dflt;
+	number_switch _cases; //statement indices
+	string_switch _string_cases;
+	bool _strings;
 public:
 	switch_statement(switch_statement&& orig):
 		_e(orig._e),
 		_ss(std::move(orig._ss)),
 		_cases(std::move(orig._cases)),
-		_dflt(orig._dflt){
+		_string_cases(std::move(orig._string_cases)),
+		_strings(orig._strings){
 	}
 	switch_statement(const switch_statement& orig):
 		_e(orig._e),
 		_ss(orig._ss),
 		_cases(orig._cases),
-		_dflt(orig._dflt){
+		_string_cases(orig._string_cases),
+		_strings(orig._strings){
 	}
-	switch_statement(expression_ptr e, std::vector<statement>&& ss, std::unordered_map<number, size_t>&& cases, size_t dflt):
+	switch_statement(expression_ptr e, std::vector<statement>&& ss, number_switch&& cases):
 		_e(e),
 		_ss(ss),
-		_cases(cases),
-		_dflt(dflt){
+		_cases(std::move(cases)),
+		_strings(false){
 	}
+	switch_statement(expression_ptr e, std::vector<statement>&& ss, string_switch&& cases):
+		_e(e),
+		_ss(ss),
+		_string_cases(std::move(cases)),
+		_strings(true){
+	}
+	
+	void lower(bytecode_builder& b) const;
 	
 	statement_retval operator()(runtime_context& ctx) const{
-		size_t idx = _ss.size();
-		auto it = _cases.find(_e->as_number(ctx));
-		if(it != _cases.end()){
-			idx = it->second;
-		}else{
-			idx = _dflt;
-		}
+		size_t idx = _strings ? _string_cases.find(_e->as_param(ctx)) : _cases.find(_e->as_number(ctx));
 		
 		for(; idx < _ss.size(); ++idx){
 			switch(_ss[idx](ctx)){
 				case statement_retval::brk:
 					return statement_retval::nxt;
+				case statement_retval::cnt:
+					return statement_retval::cnt;
 				case statement_retval::ret:
 					return statement_retval::ret;
 				default:
@@ -359,6 +386,13 @@ public:
 	return_statement(const return_statement& orig):
 		_e(orig._e){
 	}
+	
+	expression_ptr get_expression() const{
+		return _e;
+	}
+	
+	void lower(bytecode_builder& b) const;
+	
 	statement_retval operator()(runtime_context& ctx) const{
 		ctx.set_retval(_e->as_param(ctx));
 		return statement_retval::ret;
@@ -2,18 +2,24 @@
 #include "cpp/native_function.hpp"
 #include <unordered_set>
 #include <algorithm>
+#include <cstring>
 
 namespace donkey{
 
-static integer string_length(std::string that){
-	return that.size();
+static integer string_length(const variable& that){
+	return that.string_length_unsafe();
 }
 
-static std::string string_substr(const std::string& that, integer pos, integer len){
-	if((size_t)pos >= that.size()){
-		return "";
+static integer string_hash(const variable& that){
+	return that.string_hash_unsafe();
+}
+
+static variable string_substr(const variable& that, integer pos, integer len){
+	size_t sz = that.string_length_unsafe();
+	if((size_t)pos >= sz){
+		return variable("");
 	}
-	return that.substr(pos, len);
+	return variable(that.as_string_unsafe() + pos, std::min((size_t)len, sz - pos));
 }
 
 static variable string_to_string(const variable& that, runtime_context&, size_t){
@@ -21,14 +27,17 @@ static variable string_to_string(const variable& that, runtime_context&, size_t)
 }
 
 
-static variable string_split(const std::string& that, std::string separator){
-	std::vector<std::string> parts;
+static variable string_split(const variable& that, std::string separator){
+	const char* s = that.as_string_unsafe();
+	size_t sz = that.string_length_unsafe();
+	
+	std::vector<variable> parts;
 	
 	size_t begin = 0;
 	
-	for(size_t i = 0; i != that.size();){
-		if(!that.compare(i, separator.size(), separator)){
-			parts.push_back(that.substr(begin, i - begin));
+	for(size_t i = 0; i != sz;){
+		if(sz - i >= separator.size() && !memcmp(s + i, separator.data(), separator.size())){
+			parts.push_back(variable(s + begin, i - begin));
 			i += separator.size();
 			begin = i;
 		}else{
@@ -36,12 +45,12 @@ static variable string_split(const std::string& that, std::string separator){
 		}
 	}
 	
-	parts.push_back(that.substr(begin));
+	parts.push_back(variable(s + begin, sz - begin));
 	
 	std::unique_ptr<variable[]> arr(new variable[parts.size()]);
 	
 	for(size_t i = 0; i < parts.size(); ++i){
-		arr[i] = variable(parts[i]);
+		arr[i] = std::move(parts[i]);
 	}
 	
 	variable ret =  create_initialized_array(arr.get(), parts.size());
@@ -50,40 +59,55 @@ static variable string_split(const std::string& that, std::string separator){
 	return ret;
 }
 
-static std::string string_trim(const std::string& that){
-	auto begin = std::find_if(that.begin(), that.end(), [](char c){return !isspace(c);});
-	if(begin == that.end()){
-		return "";
-	}
+static variable string_trim(const variable& that){
+	const char* begin = that.as_string_unsafe();
+	const char* end = begin + that.string_length_unsafe();
 	
-	auto end = std::find_if(that.rbegin(), that.rend(), [](char c){return !isspace(c);}).base();
+	begin = std::find_if(begin, end, [](char c){return !isspace(c);});
+	while(end != begin && isspace(end[-1])){
+		--end;
+	}
 	
-	return std::string(begin, end);
+	return variable(begin, end - begin);
 }
 
-static number string_eq(const std::string& that, const variable& oth){
-	return oth.get_data_type() == var_type::string && that == oth.as_string_unsafe();
+static number string_eq(const variable& that, const variable& oth){
+	return oth.get_data_type() == var_type::string && that.string_equals_unsafe(oth);
 }
 
-static number string_ne(const std::string& that, const variable& oth){
-	return oth.get_data_type() != var_type::string || that != oth.as_string_unsafe();
+static number string_ne(const variable& that, const variable& oth){
+	return oth.get_data_type() != var_type::string || !that.string_equals_unsafe(oth);
 }
 
-static number string_lt(const std::string& that, const std::string& oth){
-	return that < oth;
+static int string_compare(const variable& that, const char* oth, size_t oth_sz){
+	size_t sz = that.string_length_unsafe();
+	int c = memcmp(that.as_string_unsafe(), oth, std::min(sz, oth_sz));
+	if(c){
+		return c;
+	}
+	return sz < oth_sz ? -1 : sz > oth_sz;
 }
 
-static number string_gt(const std::string& that, const std::string& oth){
-	return that > oth;
+//other strings are compared in place, everything else through its string conversion
+#define STRING_RELATION(name, cpp)\
+static variable name(const variable& that, runtime_context& ctx, size_t params_size){\
+	if(!params_size){\
+		runtime_error("not enough function parameters provided");\
+	}\
+	const variable& oth = ctx.top(params_size - 1);\
+	if(oth.get_data_type() == var_type::string){\
+		return variable(number(string_compare(that, oth.as_string_unsafe(), oth.string_length_unsafe()) cpp 0));\
+	}\
+	std::string s = oth.to_string(ctx);\
+	return variable(number(string_compare(that, s.data(), s.size()) cpp 0));\
 }
 
-static number string_le(const std::string& that, const std::string& oth){
-	return that <= oth;
-}
+STRING_RELATION(string_lt, <)
+STRING_RELATION(string_gt, >)
+STRING_RELATION(string_le, <=)
+STRING_RELATION(string_ge, >=)
 
-static number string_ge(const std::string& that, const std::string& oth){
-	return that >= oth;
-}
+#undef STRING_RELATION
 
 vtable_ptr string_vtable(){
 	static vtable_ptr ret([](){
@@ -94,6 +118,8 @@ vtable_ptr string_vtable(){
 		
 		methods.emplace("length", create_native_method("string::length", &string_length));
 		
+		methods.emplace("hash", create_native_method("string::hash", &string_hash));
+		
 		methods.emplace("substr", create_native_method("string::substr", &string_substr, std::make_tuple(0, integer(std::string::npos))));
 		
 		methods.emplace("split", create_native_method("string::split", &string_split));
@@ -101,10 +127,10 @@ vtable_ptr string_vtable(){
 		
 		methods.emplace("opEQ", create_native_method("string::opEQ", &string_eq));
 		methods.emplace("opNE", create_native_method("string::opNE", &string_ne));
-		methods.emplace("opLT", create_native_method("string::opLT", &string_lt));
-		methods.emplace("opGT", create_native_method("string::opGT", &string_gt));
-		methods.emplace("opLE", create_native_method("string::opLE", &string_le));
-		methods.emplace("opGE", create_native_method("string::opGE", &string_ge));
+		methods.emplace("opLT", method_ptr(new method(&string_lt)));
+		methods.emplace("opGT", method_ptr(new method(&string_gt)));
+		methods.emplace("opLE", method_ptr(new method(&string_le)));
+		methods.emplace("opGE", method_ptr(new method(&string_ge)));
 		
 		vtable* vt = new vtable("", "string", method_ptr(), method_ptr(), std::move(methods), std::move(fields), 0, true, true);
 		
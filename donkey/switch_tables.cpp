@@ -0,0 +1,103 @@
+#include "switch_tables.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace donkey{
+
+number_switch::number_switch(const std::unordered_map<number, int32_t>& cases, int32_t dflt):
+	_min(0),
+	_dflt(dflt){
+	if(cases.empty()){
+		return;
+	}
+
+	bool integral = true;
+	number min = cases.begin()->first;
+	number max = min;
+	for(const auto& p: cases){
+		integral = integral && std::floor(p.first) == p.first;
+		min = std::min(min, p.first);
+		max = std::max(max, p.first);
+	}
+
+	//a jump table when it would be at least a quarter full
+	if(integral && max - min < 4 * cases.size()){
+		_min = min;
+		_dense.resize(size_t(max - min) + 1, dflt);
+		for(const auto& p: cases){
+			_dense[size_t(p.first - min)] = p.second;
+		}
+	}else{
+		_sparse.assign(cases.begin(), cases.end());
+		std::sort(_sparse.begin(), _sparse.end());
+	}
+}
+
+int32_t number_switch::find_sparse(number n) const{
+	auto it = std::lower_bound(_sparse.begin(), _sparse.end(), n, [](const std::pair<number, int32_t>& p, number n){
+		return p.first < n;
+	});
+	if(it != _sparse.end() && it->first == n){
+		return it->second;
+	}
+	return _dflt;
+}
+
+string_switch::string_switch(const std::unordered_map<std::string, int32_t>& cases, int32_t dflt):
+	_seed(1),
+	_shift(32),
+	_dflt(dflt){
+	for(const auto& p: cases){
+		_entries.push_back(entry{p.first, compute_string_hash(p.first.data(), p.first.size()), p.second});
+	}
+
+	unsigned bits = 0;
+	while((size_t(1) << bits) < _entries.size()){
+		++bits;
+	}
+
+	//tries odd multipliers, doubling the table now and then; cases whose hashes are equal
+	//share a slot whatever the multiplier, so the last one tried is kept if none separates them
+	std::vector<uint32_t> hashes;
+	std::vector<bool> used;
+	uint32_t seed = 2654435769u;
+	for(unsigned max_bits = bits + 4; ; ++bits){
+		bool found = false;
+		for(int i = 0; i != 64 && !found; ++i){
+			_seed = seed;
+			_shift = 32 - bits;
+			seed = (seed * 1664525u + 1013904223u) | 1;
+
+			hashes.assign(size_t(1) << bits, 0);
+			used.assign(size_t(1) << bits, false);
+			found = true;
+			for(const entry& e: _entries){
+				uint32_t s = slot(e.hash);
+				if(used[s] && hashes[s] != e.hash){
+					found = false;
+					break;
+				}
+				used[s] = true;
+				hashes[s] = e.hash;
+			}
+		}
+		if(found || bits == max_bits){
+			break;
+		}
+	}
+
+	std::stable_sort(_entries.begin(), _entries.end(), [this](const entry& l, const entry& r){
+		return slot(l.hash) < slot(r.hash);
+	});
+
+	_slots.assign((size_t(1) << bits) + 1, 0);
+	for(const entry& e: _entries){
+		++_slots[slot(e.hash) + 1];
+	}
+	for(size_t i = 1; i < _slots.size(); ++i){
+		_slots[i] += _slots[i-1];
+	}
+}
+
+}//donkey
@@ -0,0 +1,114 @@
+#ifndef __switch_tables_hpp__
+#define __switch_tables_hpp__
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <cstring>
+
+#include "variables.hpp"
+
+namespace donkey{
+
+//case values of a numeric switch and their targets; other values go to the default target
+class number_switch{
+	friend class module_cache;
+private:
+	number _min;
+	std::vector<int32_t> _dense; //targets of _min, _min + 1, ...; holes hold the default target
+	std::vector<std::pair<number, int32_t> > _sparse; //sorted by value, used when the cases are far apart
+	int32_t _dflt;
+
+	int32_t find_sparse(number n) const;
+public:
+	number_switch():
+		_min(0),
+		_dflt(0){
+	}
+
+	number_switch(const std::unordered_map<number, int32_t>& cases, int32_t dflt);
+
+	int32_t find(number n) const{
+		if(_dense.empty()){
+			return find_sparse(n);
+		}
+		number d = n - _min;
+		if(d >= 0 && d < _dense.size()){
+			size_t i = size_t(d);
+			if(number(i) == d){
+				return _dense[i];
+			}
+		}
+		return _dflt;
+	}
+
+	template<typename F>
+	void map_targets(F f){
+		for(int32_t& t: _dense){
+			t = f(t);
+		}
+		for(auto& p: _sparse){
+			p.second = f(p.second);
+		}
+		_dflt = f(_dflt);
+	}
+};
+
+//case values of a string switch and their targets, placed by a hash function chosen when the switch is compiled,
+//so that each slot holds at most one case
+class string_switch{
+	friend class module_cache;
+private:
+	struct entry{
+		std::string s;
+		uint32_t hash;
+		int32_t target;
+	};
+
+	std::vector<entry> _entries; //ordered by slot
+	std::vector<uint32_t> _slots; //the entries of slot i are [_slots[i], _slots[i+1])
+	uint32_t _seed;
+	unsigned _shift;
+	int32_t _dflt;
+
+	uint32_t slot(uint32_t hash) const{
+		return uint32_t(uint64_t(uint32_t(hash * _seed)) >> _shift);
+	}
+public:
+	string_switch():
+		_slots(2, 0),
+		_seed(1),
+		_shift(32),
+		_dflt(0){
+	}
+
+	string_switch(const std::unordered_map<std::string, int32_t>& cases, int32_t dflt);
+
+	int32_t find(const char* s, size_t sz, uint32_t hash) const{
+		uint32_t i = slot(hash);
+		for(uint32_t e = _slots[i]; e != _slots[i+1]; ++e){
+			const entry& c = _entries[e];
+			if(c.hash == hash && c.s.size() == sz && memcmp(c.s.data(), s, sz) == 0){
+				return c.target;
+			}
+		}
+		return _dflt;
+	}
+
+	int32_t find(const variable& v) const{
+		const char* s = v.as_string();
+		return find(s, v.string_length_unsafe(), v.string_hash_unsafe());
+	}
+
+	template<typename F>
+	void map_targets(F f){
+		for(entry& e: _entries){
+			e.target = f(e.target);
+		}
+		_dflt = f(_dflt);
+	}
+};
+
+}//donkey
+
+#endif /*__switch_tables_hpp__*/
@@ -39,6 +39,26 @@ public:
 		_fetch_next_token();
 	}
 	
+	//just past the current token
+	const char* get_position() const{
+		return _current;
+	}
+	
+	//offset of get_position() in the source
+	size_t get_offset() const{
+		return _current - _begin;
+	}
+	
+	//continues with the first token at or after p
+	void seek(const char* p){
+		_current = p;
+		_fetch_next_token();
+	}
+	
+	void seek_offset(size_t offset){
+		seek(_begin + offset);
+	}
+	
 	explicit operator bool() const {
 		return _tt != tt_eof;
 	}
@@ -1,10 +1,65 @@
 #include "variables.hpp"
 #include "vtable.hpp"
 
+#include <algorithm>
+
 namespace donkey{
 
+heap_header* heap_header::create_string_buffer(size_t sz, size_t capacity){
+	if(capacity >= UINT32_MAX - sizeof(string_info) - 1){
+		runtime_error("string is too long");
+	}
+	//the rest of the pool block is spare room
+	size_t payload_size = (sizeof(heap_header) + sizeof(string_info) + capacity + allocation_granularity) / allocation_granularity * allocation_granularity - sizeof(heap_header);
+	void* mem = allocate(payload_size);
+	heap_header* ret = new(mem) heap_header(string_vtable().get(), &trivial_deleter, payload_size);
+	ret->get_string_info() = string_info{uint32_t(sz), 0};
+	ret->string_buffer()[sz] = 0;
+	return ret;
+}
+
+heap_header* heap_header::create_string(const char* s, size_t sz){
+	heap_header* ret = create_string_buffer(sz, sz);
+	memcpy(ret->string_buffer(), s, sz);
+	return ret;
+}
+
+heap_header* heap_header::create_object(vtable* vt, runtime_context* ctx){
+	size_t sz = donkey_object::get_allocation_size(vt);
+	void* mem = allocate(sz);
+	new(static_cast<heap_header*>(mem) + 1) donkey_object(vt, ctx);
+	return new(mem) heap_header(vt, &deleter<donkey_object>, sz);
+}
+
+void variable::append_string(const char* s, size_t sz){
+	size_t len = string_length_unsafe();
+	if(_type() == var_type::string){
+		heap_header* h = _reference();
+		if(h->_s_count == 1 && h->_u_count == 1 && h->string_capacity() >= len + sz){
+			char* data = h->string_buffer();
+			memcpy(data + len, s, sz);
+			data[len + sz] = 0;
+			h->get_string_info() = heap_header::string_info{uint32_t(len + sz), 0};
+			return;
+		}
+	}
+	if(len + sz <= short_string_capacity){
+		char buf[short_string_capacity + 1];
+		memcpy(buf, as_string_unsafe(), len);
+		memcpy(buf + len, s, sz);
+		_dec_counts();
+		_set_short_string(buf, len + sz);
+		return;
+	}
+	heap_header* h = heap_header::create_string_buffer(len + sz, std::max(len + sz, 2 * len));
+	memcpy(h->string_buffer(), as_string_unsafe(), len);
+	memcpy(h->string_buffer() + len, s, sz);
+	_dec_counts();
+	_set_reference(h, var_type::string);
+}
+
 void variable::_runtime_error(std::string msg) const{
-	if(is_weak(_vt) && _h_ptr->expired()){
+	if(is_weak(_type()) && _reference()->expired()){
 		runtime_error("expired object access");
 	}else{
 		runtime_error(msg);
@@ -12,20 +67,22 @@ void variable::_runtime_error(std::string msg) const{
 }
 
 void variable::_dec_counts_impl() const{
-	switch(_vt){
+	switch(_type()){
 		case var_type::object:
-			_h_ptr->remove_shared_object(*this);
+			_reference()->remove_shared_object();
 			break;
 		case var_type::native:
+			_reference()->remove_shared_native();
+			break;
 		case var_type::string:
 		case var_type::function:
-			_h_ptr->remove_shared();
+			_reference()->remove_shared();
 			break;
 		case var_type::weak_string:
 		case var_type::weak_object:
 		case var_type::weak_function:
 		case var_type::weak_native:
-			_h_ptr->remove_weak();
+			_reference()->remove_weak();
 			break;
 		default:
 			break;
@@ -41,10 +98,10 @@ variable variable::call_functor(runtime_context& ctx, size_t params_size) const{
 }
 
 void variable::_inc_counts_impl() const{
-	if(is_shared(_vt)){
-		_h_ptr->add_shared();
+	if(is_shared(_type())){
+		_reference()->add_shared();
 	}else{
-		_h_ptr->add_weak();
+		_reference()->add_weak();
 	}
 }
 
@@ -57,8 +114,13 @@ vtable* variable::get_vtable() const{
 			return function_vtable().get();
 		case var_type::nothing:
 			return null_vtable().get();
+		case var_type::string:
+			if(_type() == var_type::short_string){
+				return string_vtable().get();
+			}
+			return _reference()->get_vtable();
 		default:
-			return _h_ptr->get_vtable();
+			return _reference()->get_vtable();
 	}
 }
 
@@ -70,7 +132,7 @@ std::string variable::get_full_type_name() const{
 std::string variable::to_string(runtime_context& ctx) const{
 	switch(get_data_type()){
 		case var_type::string:
-			return std::string(as_string_unsafe());
+			return as_std_string_unsafe();
 		case var_type::number:
 			return donkey::to_string(as_number_unsafe());
 		case var_type::code_address:
@@ -7,11 +7,14 @@
 #include "helpers.hpp"
 #include "function.hpp"
 #include "donkey_object.hpp"
+#include "allocator.hpp"
 
 #include <cstring>
 #include <cstdint>
 #include <vector>
 #include <array>
+#include <new>
+#include <limits>
 
 
 namespace donkey{
@@ -49,6 +52,7 @@ enum struct var_type: char{
 	nothing        = 0x00,
 	number         = 0x01,
 	code_address   = 0x02,
+	short_string   = 0x03,
 	
 	string         = 0x13,
 	function       = 0x14,
@@ -113,32 +117,130 @@ typedef void(*deleter_type)(void*);
 
 template<typename T>
 void deleter(void* p){
-	delete static_cast<T*>(p);
+	static_cast<T*>(p)->~T();
 }
 
-template<typename T>
-void array_deleter(void* p){
-	delete[] static_cast<T*>(p);
+inline void trivial_deleter(void*){
 }
 
+//FNV-1a; 0 is reserved for "not computed yet" in heap strings
+inline uint32_t compute_string_hash(const char* s, size_t sz){
+	uint32_t h = 2166136261u;
+	for(size_t i = 0; i != sz; ++i){
+		h = (h ^ uint8_t(s[i])) * 16777619u;
+	}
+	return h ? h : 1;
+}
+
+
+class heap_header;
 
+void possible_cycle_root(heap_header* h, bool is_object); //collector.cpp
+void release_dead_object(heap_header* h); //collector.cpp
+void release_dead_native(heap_header* h); //collector.cpp
 
+//header and payload share one allocation; the payload starts right after the header
 class heap_header{
 	heap_header(const heap_header&) = delete;
 	void operator=(const heap_header&) = delete;
 	friend class variable;
+	friend class cycle_collector;
+	friend class deferred_releaser;
 private:
 	deleter_type _deleter;
-	size_t _s_count;
-	size_t _u_count;
-	void* _p;
 	vtable* _vt;
-	heap_header(vtable* vt, void* p, deleter_type del):
+	uint32_t _s_count;
+	uint32_t _u_count;
+	uint32_t _payload_size;
+	uint8_t _color;
+	bool _buffered;
+	
+	heap_header(vtable* vt, deleter_type del, size_t payload_size):
 		_deleter(del),
+		_vt(vt),
 		_s_count(1),
 		_u_count(1),
-		_p(p),
-		_vt(vt){
+		_payload_size(uint32_t(payload_size)),
+		_color(0),
+		_buffered(false){
+	}
+	
+	void* payload(){
+		return this + 1;
+	}
+	
+	static void* allocate(size_t payload_size){
+		return pool_allocate(sizeof(heap_header) + payload_size);
+	}
+	
+	static void deallocate(void* mem, size_t payload_size){
+		pool_free(mem, sizeof(heap_header) + payload_size);
+	}
+	
+	void release(){
+		size_t payload_size = _payload_size;
+		this->~heap_header();
+		deallocate(this, payload_size);
+	}
+	
+	void destroy_payload(){
+		_deleter(payload());
+		_deleter = nullptr;
+	}
+	
+	void destroy(){
+		destroy_payload();
+		--_u_count;
+		if(!_u_count){
+			release();
+		}
+	}
+	
+	//heap strings: the length and the cached hash, then the characters and the terminator;
+	//strings grown by appending keep spare room after the terminator
+	struct string_info{
+		uint32_t length;
+		uint32_t hash;
+	};
+	
+	string_info& get_string_info(){
+		return *static_cast<string_info*>(payload());
+	}
+	
+	char* string_buffer(){
+		return static_cast<char*>(payload()) + sizeof(string_info);
+	}
+	
+	size_t string_capacity() const{
+		return _payload_size - sizeof(string_info) - 1;
+	}
+	
+	//the characters are left for the caller to fill
+	static heap_header* create_string_buffer(size_t sz, size_t capacity);
+	
+	static heap_header* create_string(const char* s, size_t sz);
+	
+	static heap_header* create_object(vtable* vt, runtime_context* ctx);
+	
+	template<typename T, typename... Args>
+	static heap_header* create(vtable* vt, Args&&... args){
+		static_assert(alignof(T) <= alignof(heap_header), "payload is overaligned");
+		
+		void* mem = allocate(sizeof(T));
+		try{
+			new(static_cast<heap_header*>(mem) + 1) T(std::forward<Args>(args)...);
+		}catch(...){
+			deallocate(mem, sizeof(T));
+			throw;
+		}
+		return new(mem) heap_header(vt, &deleter<T>, sizeof(T));
+	}
+	
+	template<typename T, typename... Args>
+	static heap_header* create_native(Args&&... args){
+		heap_header* ret = create<T>(nullptr, std::forward<Args>(args)...);
+		ret->_vt = static_cast<T*>(ret->payload())->get_vtable();
+		return ret;
 	}
 public:
 	void add_shared(){
@@ -149,26 +251,36 @@ public:
 	void remove_shared(){
 		--_s_count;
 		if(!_s_count){
-			_deleter(_p);
-			_p = nullptr;
+			destroy_payload();
 		}
 		--_u_count;
 		if(!_u_count){
-			delete this;
+			release();
 		}
 	}
 	
-	void remove_shared_object(const variable& v){
+	void remove_shared_object(){
 		--_s_count;
 		if(!_s_count){
-			static_cast<donkey_object*>(_p)->dispose(v);
-			_deleter(_p);
-			_p = nullptr;
+			release_dead_object(this);
+			return;
+		}
+		if(!_buffered){
+			possible_cycle_root(this, true);
 		}
 		--_u_count;
-		if(!_u_count){
-			delete this;
+	}
+	
+	void remove_shared_native(){
+		--_s_count;
+		if(!_s_count){
+			release_dead_native(this);
+			return;
+		}
+		if(!_buffered){
+			possible_cycle_root(this, false);
 		}
+		--_u_count;
 	}
 	
 	void add_weak(){
@@ -176,6 +288,9 @@ public:
 	}
 	void remove_weak(){
 		--_u_count;
+		if(!_u_count){
+			release();
+		}
 	}
 	
 	bool expired(){
@@ -184,15 +299,31 @@ public:
 	
 	template<class T>
 	T* as_t(){
-		if(_p == nullptr){
+		if(_deleter == nullptr){
 			runtime_error("null reference exception");
 		}
-		return static_cast<T*>(_p);
+		return static_cast<T*>(payload());
 	}
 	
 	vtable* get_vtable(){
 		return _vt;
 	}
+	
+	const char* string_data(){
+		return as_t<const char>() + sizeof(string_info);
+	}
+	
+	size_t string_length(){
+		return get_string_info().length;
+	}
+	
+	uint32_t string_hash(){
+		uint32_t& h = get_string_info().hash;
+		if(!h){
+			h = compute_string_hash(string_data(), string_length());
+		}
+		return h;
+	}
 };
 
 variable call_function_by_address(code_address addr, runtime_context& ctx, size_t params_size); //runtime_context.cpp
@@ -203,23 +334,191 @@ vtable_ptr string_vtable(); //core_vtables.cpp
 vtable_ptr function_vtable(); //core_vtables.cpp
 
 class variable final{
+	friend class cycle_collector;
+	friend class deferred_releaser;
 private:
-#define max_size(T1, T2, T3) (sizeof(T1) > sizeof(T2) ? (sizeof(T1) > sizeof(T3) ? sizeof(T1) : sizeof(T3)) : (sizeof(T2) > sizeof(T3) ? sizeof(T2) : sizeof(T3)))
+#ifdef DONKEY_NAN_BOXING
+	//numbers are stored as they are, everything else in the payload of a quiet NaN:
+	//bits 48-50 and the sign bit hold the tag, the low 48 bits hold the value
+	enum{
+		storage_size = 8,
+		short_string_capacity = 5,
+	};
+	
+	static const uint64_t nan_mask = 0x7ff8000000000000ull;
+	static const uint64_t smart_mask = 0x7ffc000000000000ull;
+	static const uint64_t payload_mask = 0x0000ffffffffffffull;
+	
+	union{
+		number _n;
+		uint64_t _bits;
+		char _s[short_string_capacity + 1]; //little endian
+		char _[storage_size];
+	};
+	
+	static uint64_t _tag(var_type vt){
+		switch(vt){
+			case var_type::code_address:
+				return 0x7ffaull << 48;
+			case var_type::short_string:
+				return 0x7ffbull << 48;
+			case var_type::string:
+				return 0x7ffcull << 48;
+			case var_type::function:
+				return 0x7ffdull << 48;
+			case var_type::object:
+				return 0x7ffeull << 48;
+			case var_type::native:
+				return 0x7fffull << 48;
+			case var_type::weak_string:
+				return 0xfffcull << 48;
+			case var_type::weak_function:
+				return 0xfffdull << 48;
+			case var_type::weak_object:
+				return 0xfffeull << 48;
+			case var_type::weak_native:
+				return 0xffffull << 48;
+			default:
+				return 0x7ff9ull << 48;
+		}
+	}
+	
+	var_type _type() const{
+		static const var_type types[] = {
+			var_type::number,
+			var_type::nothing,
+			var_type::code_address,
+			var_type::short_string,
+			var_type::string,
+			var_type::function,
+			var_type::object,
+			var_type::native,
+			var_type::number,
+			var_type::nothing,
+			var_type::nothing,
+			var_type::nothing,
+			var_type::weak_string,
+			var_type::weak_function,
+			var_type::weak_object,
+			var_type::weak_native,
+		};
+		if((_bits & nan_mask) != nan_mask){
+			return var_type::number;
+		}
+		return types[((_bits >> 60) & 8) | ((_bits >> 48) & 7)];
+	}
+	
+	bool _is_smart() const{
+		return (_bits & smart_mask) == smart_mask;
+	}
+	
+	void _set_nothing(){
+		_bits = _tag(var_type::nothing);
+	}
+	
+	void _set_number(number n){
+		_n = n == n ? n : std::numeric_limits<number>::quiet_NaN();
+	}
+	
+	void _set_code_address(code_address f){
+		if(f.get_module_index() > 0xffff){
+			runtime_error("too many modules");
+		}
+		_bits = _tag(var_type::code_address) | (uint64_t(f.get_module_index()) << 32) | f.get_function_index();
+	}
+	
+	code_address _code_address() const{
+		return code_address::create(uint32_t((_bits >> 32) & 0xffff), uint32_t(_bits));
+	}
+	
+	void _set_reference(heap_header* h, var_type vt){
+		_bits = _tag(vt) | reinterpret_cast<uintptr_t>(h);
+	}
+	
+	heap_header* _reference() const{
+		return reinterpret_cast<heap_header*>(uintptr_t(_bits & payload_mask));
+	}
+	
+	void _set_short_string(const char* s, size_t sz){
+		_bits = _tag(var_type::short_string);
+		memcpy(_s, s, sz);
+		_s[sz] = 0;
+	}
+#else
+	//the last byte holds var_type; short strings use the rest, including the terminator
+	enum{
+		storage_size = 16,
+		short_string_capacity = storage_size - 2,
+	};
+	
 	union{
 		number _n;
 		code_address _f;
 		heap_header* _h_ptr;
-		std::array<char, max_size(number, code_address, heap_header*)> _;
+		char _s[short_string_capacity + 1];
+		char _[storage_size];
 	};
-#undef max_size
-	var_type _vt;
+	
+	var_type _type() const{
+		return var_type(_[storage_size - 1]);
+	}
+	
+	void _set_type(var_type vt){
+		_[storage_size - 1] = char(vt);
+	}
+	
+	bool _is_smart() const{
+		return is_smart(_type());
+	}
+	
+	void _set_nothing(){
+		_set_type(var_type::nothing);
+	}
+	
+	void _set_number(number n){
+		_n = n;
+		_set_type(var_type::number);
+	}
+	
+	void _set_code_address(code_address f){
+		_f = f;
+		_set_type(var_type::code_address);
+	}
+	
+	code_address _code_address() const{
+		return _f;
+	}
+	
+	void _set_reference(heap_header* h, var_type vt){
+		_h_ptr = h;
+		_set_type(vt);
+	}
+	
+	heap_header* _reference() const{
+		return _h_ptr;
+	}
+	
+	void _set_short_string(const char* s, size_t sz){
+		memcpy(_s, s, sz);
+		_s[sz] = 0;
+		_set_type(var_type::short_string);
+	}
+#endif
+	
+	void _init_string(const char* s, size_t sz){
+		if(sz <= short_string_capacity){
+			_set_short_string(s, sz);
+		}else{
+			_set_reference(heap_header::create_string(s, sz), var_type::string);
+		}
+	}
 	
 	void _runtime_error(std::string msg) const;
 	
 	void _inc_counts_impl() const;
 	
 	void _inc_counts() const{
-		if(is_smart(_vt)){
+		if(_is_smart()){
 			_inc_counts_impl();
 		}
 	}
@@ -227,7 +526,7 @@ private:
 	void _dec_counts_impl() const;
 	
 	void _dec_counts() const{
-		if(is_smart(_vt)){
+		if(_is_smart()){
 			_dec_counts_impl();
 		}
 	}
@@ -235,104 +534,58 @@ private:
 	bool _to_bool(runtime_context& ctx) const;
 	
 public:
-	variable():
-		_vt(var_type::nothing){
+	variable(){
+		_set_nothing();
 	}
 	
 	void reset(){
 		_dec_counts();
-		_vt = var_type::nothing;
+		_set_nothing();
 	}
 	
-	explicit variable(number n):
-		_n(n),
-		_vt(var_type::number){
+	explicit variable(number n){
+		_set_number(n);
 	}
 	
 	variable& operator=(number n){
 		_dec_counts();
-		_n = n;
-		_vt = var_type::number;
+		_set_number(n);
 		return *this;
 	}
 	
-	explicit variable(code_address f):
-		_f(f),
-		_vt(var_type::code_address){
+	explicit variable(code_address f){
+		_set_code_address(f);
 	}
 	
 	explicit variable(const std::string& s){
-		char* p = new char[s.size() + 1];
-		if(!p){
-			runtime_error("out of memory");
-		}
-		_h_ptr = new heap_header(string_vtable().get(), p, &array_deleter<char>);
-		if(!_h_ptr){
-			delete[] p;
-			runtime_error("out of memory");
-		}
-		memcpy(p, s.c_str(), s.size()+1);
-		_vt = var_type::string;
+		_init_string(s.c_str(), s.size());
 	}
 	
 	explicit variable(const char* s){
-		if(!s){
-			s = "";
-		}
-		size_t sz = strlen(s);
-		char* p = new char[sz + 1];
-		if(!p){
-			runtime_error("out of memory");
-		}
-		_h_ptr = new heap_header(string_vtable().get(), p, &array_deleter<char>);
-		if(!_h_ptr){
-			runtime_error("out of memory");
-		}
-		memcpy(p, s, sz + 1);
-		_vt = var_type::string;
+		_init_string(s ? s : "", s ? strlen(s) : 0);
 	}
 	
+	variable(const char* s, size_t sz){
+		_init_string(s, sz);
+	}
 	
 	explicit variable(function&& f){
-		function* p = new function(std::move(f));
-		if(!p){
-			runtime_error("out of memory");
-		}
-		_h_ptr = new heap_header(function_vtable().get(), p, &deleter<function>);
-		if(!_h_ptr){
-			delete p;
-			runtime_error("out of memory");
-		}
-		_vt = var_type::function;
+		_set_reference(heap_header::create<function>(function_vtable().get(), std::move(f)), var_type::function);
 	}
 	
 	variable(vtable* vt, runtime_context& ctx){
-		donkey_object* p = new donkey_object(vt, &ctx);
-		if(!p){
-			runtime_error("out of memory");
-		}
-		_h_ptr = new heap_header(vt, p, &deleter<donkey_object>);
-		if(!_h_ptr){
-			delete p;
-			runtime_error("out of memory");
-		}
-		_vt = var_type::object;
+		_set_reference(heap_header::create_object(vt, &ctx), var_type::object);
 	}
 	
-	template<typename T>
-	explicit variable(T* p){
-		_h_ptr = new heap_header(p->get_vtable(), p, &deleter<T>);
-		if(!_h_ptr){
-			delete p;
-			runtime_error("out of memory");
-		}
-		_vt = var_type::native;
+	template<typename T, typename... Args>
+	static variable create_native(Args&&... args){
+		variable ret;
+		ret._set_reference(heap_header::create_native<T>(std::forward<Args>(args)...), var_type::native);
+		return ret;
 	}
-		
 	
-	variable(const variable& orig):
-		_(orig._),
-		_vt(orig._vt){
+	variable(const variable& orig){
+		memcpy(_, orig._, storage_size);
 		_inc_counts();
 	}
 	
@@ -343,16 +596,14 @@ public:
 		orig._inc_counts();
 		_dec_counts();
 		
-		_ = orig._;
-		_vt = orig._vt;
+		memcpy(_, orig._, storage_size);
 		
 		return *this;
 	}
 	
-	variable(variable&& orig) noexcept:
-		_(orig._),
-		_vt(orig._vt){
-		orig._vt = var_type::nothing;
+	variable(variable&& orig) noexcept{
+		memcpy(_, orig._, storage_size);
+		orig._set_nothing();
 	}
 	
 	variable& operator=(variable&& orig) noexcept{
@@ -369,10 +620,9 @@ public:
 	}
 	
 	variable non_shared() const{
-		if(is_shared(_vt)){
+		if(is_shared(_type())){
 			variable ret;
-			ret._vt = weak_version(_vt);
-			ret._h_ptr = _h_ptr;
+			ret._set_reference(_reference(), weak_version(_type()));
 			ret._inc_counts();
 			return ret;
 		}
@@ -380,13 +630,12 @@ public:
 	}
 	
 	variable non_weak() const{
-		if(is_weak(_vt)){
-			if(_h_ptr->_s_count == 0){
+		if(is_weak(_type())){
+			if(_reference()->_s_count == 0){
 				return variable();
 			}
 			variable ret;
-			ret._vt = shared_version(_vt);
-			ret._h_ptr = _h_ptr;
+			ret._set_reference(_reference(), shared_version(_type()));
 			ret._inc_counts();
 			return ret;
 		}
@@ -398,14 +647,18 @@ public:
 	}
 	
 	var_type get_var_type() const{
-		return _vt;
+		return _type();
 	}
 	
 	var_type get_data_type() const{
-		if(is_weak(_vt)){
-			return _h_ptr->_p == nullptr ? var_type::nothing : shared_version(_vt);
+		var_type vt = _type();
+		if(is_weak(vt)){
+			return _reference()->_s_count == 0 ? var_type::nothing : shared_version(vt);
 		}
-		return _vt;
+		if(vt == var_type::short_string){
+			return var_type::string;
+		}
+		return vt;
 	}
 	
 	bool is_callable() const{
@@ -418,7 +671,7 @@ public:
 	}
 	
 	number as_number() const{
-		if(_vt != var_type::number){
+		if(_type() != var_type::number){
 			_runtime_error("number expected");
 		}
 		return as_number_unsafe();
@@ -437,14 +690,14 @@ public:
 	}
 	
 	number& as_lnumber(){
-		if(_vt != var_type::number){
+		if(_type() != var_type::number){
 			_runtime_error("number expected");
 		}
 		return as_lnumber_unsafe();
 	}
 	
 	code_address as_code_address_unsafe() const{
-		return _f;
+		return _code_address();
 	}
 	
 	variable call_functor(runtime_context& ctx, size_t params_size) const;
@@ -454,14 +707,61 @@ public:
 			case var_type::code_address:
 				return call_function_by_address(as_code_address_unsafe(), ctx, params_size);
 			case var_type::function:
-				return (*_h_ptr->as_t<function>())(ctx, params_size);
+				return (*_reference()->as_t<function>())(ctx, params_size);
 			default:
 				return call_functor(ctx, params_size);
 		}
 	}
 	
 	const char* as_string_unsafe() const{
-		return _h_ptr->as_t<char>();
+		if(_type() == var_type::short_string){
+			return _s;
+		}
+		return _reference()->string_data();
+	}
+	
+	size_t string_length_unsafe() const{
+		if(_type() == var_type::short_string){
+			return strlen(_s);
+		}
+		return _reference()->string_length();
+	}
+	
+	//cached for heap strings, recomputed for short ones
+	uint32_t string_hash_unsafe() const{
+		if(_type() == var_type::short_string){
+			return compute_string_hash(_s, strlen(_s));
+		}
+		return _reference()->string_hash();
+	}
+	
+	//must be a string; appends in place when this is the only reference and there is room,
+	//otherwise reallocates with room to spare, so appending in a loop stays linear
+	void append_string(const char* s, size_t sz);
+	
+	std::string as_std_string_unsafe() const{
+		return std::string(as_string_unsafe(), string_length_unsafe());
+	}
+	
+	//both must be strings; differing lengths or cached hashes decide without comparing the characters
+	bool string_equals_unsafe(const variable& oth) const{
+		const char* s = as_string_unsafe();
+		const char* o = oth.as_string_unsafe();
+		if(s == o){
+			return true;
+		}
+		size_t sz = string_length_unsafe();
+		if(sz != oth.string_length_unsafe()){
+			return false;
+		}
+		if(_type() != var_type::short_string && oth._type() != var_type::short_string){
+			uint32_t h = _reference()->get_string_info().hash;
+			uint32_t oh = oth._reference()->get_string_info().hash;
+			if(h && oh && h != oh){
+				return false;
+			}
+		}
+		return memcmp(s, o, sz) == 0;
 	}
 	
 	const char* as_string() const{
@@ -474,7 +774,7 @@ public:
 	std::string to_string(runtime_context& ctx) const;
 	
 	heap_header* as_reference_unsafe() const{
-		return _h_ptr;
+		return _reference();
 	}
 	
 	donkey_object* as_donkey_object_unsafe() const{
@@ -498,7 +798,7 @@ public:
 	
 	variable& nth_field(size_t n) const{
 		if(get_data_type() == var_type::object){
-			return _h_ptr->as_t<donkey_object>()->get_field(n);
+			return _reference()->as_t<donkey_object>()->get_field(n);
 		}
 	
 		_runtime_error("variable doesn't have " + std::to_string(n) + " fields");
@@ -508,7 +808,7 @@ public:
 	vtable* get_vtable() const;
 	
 	bool to_bool(runtime_context& ctx) const{
-		if(_vt == var_type::number){
+		if(_type() == var_type::number){
 			return _n != 0;
 		}
 		return _to_bool(ctx);
@@ -516,6 +816,16 @@ public:
 	
 };
 
+#ifdef DONKEY_NAN_BOXING
+static_assert(sizeof(variable) == 8, "unexpected variable size");
+#else
+static_assert(sizeof(variable) == 16, "unexpected variable size");
+#endif
+
+inline variable& donkey_object::get_field(size_t i){
+	return reinterpret_cast<variable*>(this + 1)[i];
+}
+
 }//donkey
 
 #endif /*__variables_hpp__*/
@@ -0,0 +1,591 @@
+#include "vm.hpp"
+#include "donkey_function.hpp"
+#include "expressions/arithmetic_expressions.hpp"
+#include "expressions/relation_expressions.hpp"
+#include "expressions/unary_expressions.hpp"
+#include "expressions/assignment_expressions.hpp"
+
+#include <cmath>
+
+#if defined(__GNUC__)
+#	define VM_THREADED_DISPATCH
+#endif
+
+#ifdef VM_THREADED_DISPATCH
+#	define VM_CASE(name) vm_##name:
+#	define VM_DISPATCH() goto *handlers[int(pc->op)]
+#else
+#	define VM_CASE(name) case vm_op::name:
+#	define VM_DISPATCH() continue
+#endif
+
+#define VM_NEXT() ++pc; VM_DISPATCH()
+#define VM_JUMP(target) pc = code + (target); VM_DISPATCH()
+
+#define RK(x) ((x) >= 0 ? static_cast<const variable&>(R[x]) : K[~(x)])
+
+#define VM_NUMBER_BINARY(name, full, expr)\
+	VM_CASE(name){\
+		const variable& l = RK(pc->b);\
+		const variable& r = RK(pc->c);\
+		if(l.get_var_type() == var_type::number && r.get_var_type() == var_type::number){\
+			number x = l.as_number_unsafe();\
+			number y = r.as_number_unsafe();\
+			R[pc->a] = number(expr);\
+		}else{\
+			R[pc->a] = full(l, r, ctx);\
+		}\
+	}\
+	VM_NEXT();
+
+#define VM_NUMBER_UNARY(name, full, expr)\
+	VM_CASE(name){\
+		const variable& l = RK(pc->b);\
+		if(l.get_var_type() == var_type::number){\
+			number x = l.as_number_unsafe();\
+			R[pc->a] = number(expr);\
+		}else{\
+			R[pc->a] = full(l, ctx);\
+		}\
+	}\
+	VM_NEXT();
+
+#define VM_ASSIGNMENT(name, op)\
+	VM_CASE(name){\
+		op(R[pc->a], RK(pc->b), ctx);\
+	}\
+	VM_NEXT();
+
+#define VM_JUMP_RELATION(name, cpp, full)\
+	VM_CASE(name){\
+		const variable& l = RK(pc->b);\
+		const variable& r = RK(pc->c);\
+		bool cond;\
+		if(l.get_var_type() == var_type::number && r.get_var_type() == var_type::number){\
+			cond = l.as_number_unsafe() cpp r.as_number_unsafe();\
+		}else{\
+			cond = full(l, r, ctx).to_bool(ctx);\
+		}\
+		if(cond == bool(pc->d)){\
+			VM_JUMP(pc->a);\
+		}\
+	}\
+	VM_NEXT();
+
+#define VM_NUM_BINARY(name, expr)\
+	VM_CASE(name){\
+		number x = RK(pc->b).as_number_unsafe();\
+		number y = RK(pc->c).as_number_unsafe();\
+		R[pc->a] = number(expr);\
+	}\
+	VM_NEXT();
+
+#define VM_NUM_ASSIGNMENT(name, cpp)\
+	VM_CASE(name){\
+		R[pc->a].as_lnumber_unsafe() cpp RK(pc->b).as_number_unsafe();\
+	}\
+	VM_NEXT();
+
+#define VM_NUM_JUMP_RELATION(name, cpp)\
+	VM_CASE(name){\
+		if((RK(pc->b).as_number_unsafe() cpp RK(pc->c).as_number_unsafe()) == bool(pc->d)){\
+			VM_JUMP(pc->a);\
+		}\
+	}\
+	VM_NEXT();
+
+#define VM_NUM_LOOP(name, cpp)\
+	VM_CASE(name){\
+		number& i = R[pc->b].as_lnumber_unsafe();\
+		i += RK(pc->d).as_number_unsafe();\
+		if(i cpp RK(pc->c).as_number_unsafe()){\
+			VM_JUMP(pc->a);\
+		}\
+	}\
+	VM_NEXT();
+
+namespace donkey{
+
+void program::link(runtime_context& ctx) const{
+	for(callee& f: _callees){
+		f.native = &function_by_address(f.address, ctx);
+		f.code = f.native->target<donkey_function>();
+	}
+}
+
+bool program::is_inlinable() const{
+	if(_code.size() < 2){
+		return false;
+	}
+	//the marks of the bodies inlined into this one are not counted
+	size_t size = _code.size() - 2;
+	for(const instruction& i: _code){
+		switch(i.op){
+			case vm_op::jump_expression:
+			case vm_op::eval:
+			case vm_op::exec:
+			case vm_op::exec_statement:
+			case vm_op::call_expression:
+				return false;
+			case vm_op::enter_inline:
+			case vm_op::leave_inline:
+				--size;
+				break;
+			default:
+				break;
+		}
+	}
+	if(size > max_inline_size){
+		return false;
+	}
+	vm_op last = _code[_code.size() - 2].op;
+	return (last == vm_op::ret || last == vm_op::tail_call_function) && _code.back().op == vm_op::end;
+}
+
+size_t program::get_counted_loops() const{
+	size_t ret = 0;
+	for(const instruction& i: _code){
+		switch(i.op){
+			case vm_op::num_loop_less:
+			case vm_op::num_loop_greater:
+			case vm_op::num_loop_less_equal:
+			case vm_op::num_loop_greater_equal:
+			case vm_op::num_loop_unequal:
+				++ret;
+				break;
+			default:
+				break;
+		}
+	}
+	return ret;
+}
+
+void program::link_inlined_frames(){
+	_inlined_frames.clear();
+	for(size_t i = 0; i != _inlined.size(); ++i){
+		_inlined_frames.push_back(inlined_frame{&_inlined[i], nullptr});
+	}
+	for(size_t i = 0; i != _inlined_outer.size(); ++i){
+		if(_inlined_outer[i] >= 0){
+			_inlined_frames[i].outer = &_inlined_frames[_inlined_outer[i]];
+		}
+	}
+}
+
+const donkey_function* program::run(runtime_context& ctx) const{
+	stack_pusher frame(ctx, _frame_size);
+	frame.push_default(_frame_size);
+
+	variable* const R = &ctx.local(0);
+	const variable* const K = _constants.data();
+	const expression_ptr* const E = _expressions.data();
+	const instruction* const code = _code.data();
+	const instruction* pc = code;
+
+#ifdef VM_THREADED_DISPATCH
+	static const void* const handlers[] = {
+		&&vm_move,
+		&&vm_null,
+		&&vm_clear,
+		&&vm_load_global,
+		&&vm_store_global,
+		&&vm_get_item,
+		&&vm_set_item,
+		&&vm_mul,
+		&&vm_div,
+		&&vm_idiv,
+		&&vm_mod,
+		&&vm_plus,
+		&&vm_minus,
+		&&vm_shiftl,
+		&&vm_shiftr,
+		&&vm_bitwise_and,
+		&&vm_bitwise_xor,
+		&&vm_bitwise_or,
+		&&vm_less,
+		&&vm_greater,
+		&&vm_less_equal,
+		&&vm_greater_equal,
+		&&vm_equal,
+		&&vm_unequal,
+		&&vm_unary_plus,
+		&&vm_unary_minus,
+		&&vm_bitwise_not,
+		&&vm_logical_not,
+		&&vm_pre_inc,
+		&&vm_pre_dec,
+		&&vm_post_inc,
+		&&vm_post_dec,
+		&&vm_mul_assignment,
+		&&vm_div_assignment,
+		&&vm_mod_assignment,
+		&&vm_plus_assignment,
+		&&vm_minus_assignment,
+		&&vm_shiftl_assignment,
+		&&vm_shiftr_assignment,
+		&&vm_and_assignment,
+		&&vm_xor_assignment,
+		&&vm_or_assignment,
+		&&vm_num_mul,
+		&&vm_num_div,
+		&&vm_num_mod,
+		&&vm_num_plus,
+		&&vm_num_minus,
+		&&vm_num_less,
+		&&vm_num_greater,
+		&&vm_num_less_equal,
+		&&vm_num_greater_equal,
+		&&vm_num_equal,
+		&&vm_num_unequal,
+		&&vm_num_pre_inc,
+		&&vm_num_pre_dec,
+		&&vm_num_post_inc,
+		&&vm_num_post_dec,
+		&&vm_num_mul_assignment,
+		&&vm_num_div_assignment,
+		&&vm_num_mod_assignment,
+		&&vm_num_plus_assignment,
+		&&vm_num_minus_assignment,
+		&&vm_jump,
+		&&vm_jump_if,
+		&&vm_jump_less,
+		&&vm_jump_greater,
+		&&vm_jump_less_equal,
+		&&vm_jump_greater_equal,
+		&&vm_jump_equal,
+		&&vm_jump_unequal,
+		&&vm_num_jump_less,
+		&&vm_num_jump_greater,
+		&&vm_num_jump_less_equal,
+		&&vm_num_jump_greater_equal,
+		&&vm_num_jump_equal,
+		&&vm_num_jump_unequal,
+		&&vm_num_loop_less,
+		&&vm_num_loop_greater,
+		&&vm_num_loop_less_equal,
+		&&vm_num_loop_greater_equal,
+		&&vm_num_loop_unequal,
+		&&vm_jump_expression,
+		&&vm_switch_number,
+		&&vm_switch_string,
+		&&vm_eval,
+		&&vm_exec,
+		&&vm_exec_statement,
+		&&vm_call,
+		&&vm_call_function,
+		&&vm_tail_call_function,
+		&&vm_call_expression,
+		&&vm_enter_inline,
+		&&vm_leave_inline,
+		&&vm_ret,
+		&&vm_end,
+	};
+	static_assert(sizeof(handlers) / sizeof(handlers[0]) == size_t(vm_op::count), "vm handlers table out of sync");
+
+	VM_DISPATCH();
+#else
+	for(;;){
+		switch(pc->op){
+#endif
+
+	VM_CASE(move){
+		R[pc->a] = RK(pc->b);
+	}
+	VM_NEXT();
+
+	VM_CASE(null){
+		R[pc->a].reset();
+	}
+	VM_NEXT();
+
+	VM_CASE(clear){
+		for(int32_t i = 0; i < pc->b; ++i){
+			R[pc->a + i].reset();
+		}
+	}
+	VM_NEXT();
+
+	VM_CASE(load_global){
+		R[pc->a] = global_variable(ctx, pc->b, pc->c);
+	}
+	VM_NEXT();
+
+	VM_CASE(store_global){
+		global_variable(ctx, pc->a, pc->b) = RK(pc->c);
+	}
+	VM_NEXT();
+
+	VM_CASE(get_item){
+		R[pc->a] = get_item(ctx, RK(pc->b), variable(RK(pc->c)));
+	}
+	VM_NEXT();
+
+	VM_CASE(set_item){
+		set_item(ctx, RK(pc->a), variable(RK(pc->b)), variable(RK(pc->c)));
+	}
+	VM_NEXT();
+
+	VM_NUMBER_BINARY(mul, mul_full, x * y)
+	VM_NUMBER_BINARY(div, div_full, x / y)
+	VM_NUMBER_BINARY(idiv, idiv_full, (integer)x / (integer)y)
+	VM_NUMBER_BINARY(mod, mod_full, fmod(x, y))
+	VM_NUMBER_BINARY(plus, plus_full, x + y)
+	VM_NUMBER_BINARY(minus, minus_full, x - y)
+	VM_NUMBER_BINARY(shiftl, shiftl_full, (integer)x << (integer)y)
+	VM_NUMBER_BINARY(shiftr, shiftr_full, (integer)x >> (integer)y)
+	VM_NUMBER_BINARY(bitwise_and, bitwise_and_full, (integer)x & (integer)y)
+	VM_NUMBER_BINARY(bitwise_xor, bitwise_xor_full, (integer)x ^ (integer)y)
+	VM_NUMBER_BINARY(bitwise_or, bitwise_or_full, (integer)x | (integer)y)
+	VM_NUMBER_BINARY(less, lt_full, x < y)
+	VM_NUMBER_BINARY(greater, gt_full, x > y)
+	VM_NUMBER_BINARY(less_equal, le_full, x <= y)
+	VM_NUMBER_BINARY(greater_equal, ge_full, x >= y)
+	VM_NUMBER_BINARY(equal, eq_full, x == y)
+	VM_NUMBER_BINARY(unequal, ne_full, x != y)
+
+	VM_NUMBER_UNARY(unary_plus, u_plus_full, +x)
+	VM_NUMBER_UNARY(unary_minus, u_minus_full, -x)
+	VM_NUMBER_UNARY(bitwise_not, bitwise_not_full, ~(integer)x)
+
+	VM_CASE(logical_not){
+		R[pc->a] = number(RK(pc->b).to_bool(ctx) ? 0 : 1);
+	}
+	VM_NEXT();
+
+	VM_CASE(pre_inc){
+		pre_inc(R[pc->a], ctx);
+	}
+	VM_NEXT();
+
+	VM_CASE(pre_dec){
+		pre_dec(R[pc->a], ctx);
+	}
+	VM_NEXT();
+
+	VM_CASE(post_inc){
+		R[pc->a] = post_inc(R[pc->b], ctx);
+	}
+	VM_NEXT();
+
+	VM_CASE(post_dec){
+		R[pc->a] = post_dec(R[pc->b], ctx);
+	}
+	VM_NEXT();
+
+	VM_ASSIGNMENT(mul_assignment, mul_assign)
+	VM_ASSIGNMENT(div_assignment, div_assign)
+	VM_ASSIGNMENT(mod_assignment, mod_assign)
+	VM_ASSIGNMENT(plus_assignment, plus_assign)
+	VM_ASSIGNMENT(minus_assignment, minus_assign)
+	VM_ASSIGNMENT(shiftl_assignment, shiftl_assign)
+	VM_ASSIGNMENT(shiftr_assignment, shiftr_assign)
+	VM_ASSIGNMENT(and_assignment, bitwise_and_assign)
+	VM_ASSIGNMENT(xor_assignment, bitwise_xor_assign)
+	VM_ASSIGNMENT(or_assignment, bitwise_or_assign)
+
+	VM_NUM_BINARY(num_mul, x * y)
+	VM_NUM_BINARY(num_div, x / y)
+	VM_NUM_BINARY(num_mod, fmod(x, y))
+	VM_NUM_BINARY(num_plus, x + y)
+	VM_NUM_BINARY(num_minus, x - y)
+	VM_NUM_BINARY(num_less, x < y)
+	VM_NUM_BINARY(num_greater, x > y)
+	VM_NUM_BINARY(num_less_equal, x <= y)
+	VM_NUM_BINARY(num_greater_equal, x >= y)
+	VM_NUM_BINARY(num_equal, x == y)
+	VM_NUM_BINARY(num_unequal, x != y)
+
+	VM_CASE(num_pre_inc){
+		++R[pc->a].as_lnumber_unsafe();
+	}
+	VM_NEXT();
+
+	VM_CASE(num_pre_dec){
+		--R[pc->a].as_lnumber_unsafe();
+	}
+	VM_NEXT();
+
+	VM_CASE(num_post_inc){
+		R[pc->a] = R[pc->b].as_lnumber_unsafe()++;
+	}
+	VM_NEXT();
+
+	VM_CASE(num_post_dec){
+		R[pc->a] = R[pc->b].as_lnumber_unsafe()--;
+	}
+	VM_NEXT();
+
+	VM_NUM_ASSIGNMENT(num_mul_assignment, *=)
+	VM_NUM_ASSIGNMENT(num_div_assignment, /=)
+	VM_NUM_ASSIGNMENT(num_plus_assignment, +=)
+	VM_NUM_ASSIGNMENT(num_minus_assignment, -=)
+
+	VM_CASE(num_mod_assignment){
+		number& x = R[pc->a].as_lnumber_unsafe();
+		x = fmod(x, RK(pc->b).as_number_unsafe());
+	}
+	VM_NEXT();
+
+	VM_CASE(jump){
+		VM_JUMP(pc->a);
+	}
+
+	VM_CASE(jump_if){
+		if(RK(pc->b).to_bool(ctx) == bool(pc->d)){
+			VM_JUMP(pc->a);
+		}
+	}
+	VM_NEXT();
+
+	VM_JUMP_RELATION(jump_less, <, lt_full)
+	VM_JUMP_RELATION(jump_greater, >, gt_full)
+	VM_JUMP_RELATION(jump_less_equal, <=, le_full)
+	VM_JUMP_RELATION(jump_greater_equal, >=, ge_full)
+	VM_JUMP_RELATION(jump_equal, ==, eq_full)
+	VM_JUMP_RELATION(jump_unequal, !=, ne_full)
+
+	VM_NUM_JUMP_RELATION(num_jump_less, <)
+	VM_NUM_JUMP_RELATION(num_jump_greater, >)
+	VM_NUM_JUMP_RELATION(num_jump_less_equal, <=)
+	VM_NUM_JUMP_RELATION(num_jump_greater_equal, >=)
+	VM_NUM_JUMP_RELATION(num_jump_equal, ==)
+	VM_NUM_JUMP_RELATION(num_jump_unequal, !=)
+
+	VM_NUM_LOOP(num_loop_less, <)
+	VM_NUM_LOOP(num_loop_greater, >)
+	VM_NUM_LOOP(num_loop_less_equal, <=)
+	VM_NUM_LOOP(num_loop_greater_equal, >=)
+	VM_NUM_LOOP(num_loop_unequal, !=)
+
+	VM_CASE(jump_expression){
+		if(E[pc->b]->as_bool(ctx) == bool(pc->d)){
+			VM_JUMP(pc->a);
+		}
+	}
+	VM_NEXT();
+
+	VM_CASE(switch_number){
+		VM_JUMP(_switches[pc->b].find(RK(pc->a).as_number()));
+	}
+
+	VM_CASE(switch_string){
+		VM_JUMP(_string_switches[pc->b].find(RK(pc->a)));
+	}
+
+	VM_CASE(eval){
+		R[pc->a] = E[pc->b]->as_param(ctx);
+	}
+	VM_NEXT();
+
+	VM_CASE(exec){
+		E[pc->a]->as_void(ctx);
+	}
+	VM_NEXT();
+
+	VM_CASE(exec_statement){
+		if(_statements[pc->a](ctx) == statement_retval::ret){
+			return nullptr;
+		}
+	}
+	VM_NEXT();
+
+	VM_CASE(call){
+		variable ret;
+		{
+			stack_pusher pusher(ctx, pc->c);
+			for(int32_t i = 0; i < pc->c; ++i){
+				pusher.push(std::move(R[pc->b + i]));
+			}
+			ret = RK(pc->d).call(ctx, pc->c);
+		}
+		if(pc->a >= 0){
+			R[pc->a] = std::move(ret);
+		}
+	}
+	VM_NEXT();
+
+	VM_CASE(call_function){
+		variable ret;
+		{
+			const callee& f = _callees[pc->d];
+			stack_pusher pusher(ctx, pc->c);
+			for(int32_t i = 0; i < pc->c; ++i){
+				pusher.push(std::move(R[pc->b + i]));
+			}
+			ret = f.code ? (*f.code)(ctx, pc->c) : (*f.native)(ctx, pc->c);
+		}
+		if(pc->a >= 0){
+			R[pc->a] = std::move(ret);
+		}
+	}
+	VM_NEXT();
+
+	//donkey functions are left to the caller's donkey_function, which runs them once this frame is gone
+	VM_CASE(tail_call_function){
+		const callee& f = _callees[pc->d];
+		if(f.code){
+			std::vector<variable>& params = ctx.tail_params();
+			for(int32_t i = 0; i < pc->c; ++i){
+				params.push_back(std::move(R[pc->b + i]));
+			}
+			return f.code;
+		}
+		variable ret;
+		{
+			stack_pusher pusher(ctx, pc->c);
+			for(int32_t i = 0; i < pc->c; ++i){
+				pusher.push(std::move(R[pc->b + i]));
+			}
+			ret = (*f.native)(ctx, pc->c);
+		}
+		ctx.set_retval(std::move(ret));
+	}
+	return nullptr;
+
+	VM_CASE(call_expression){
+		variable ret;
+		{
+			stack_pusher pusher(ctx, pc->c);
+			for(int32_t i = 0; i < pc->c; ++i){
+				pusher.push(std::move(R[pc->b + i]));
+			}
+			ret = E[pc->d]->call(ctx, pc->c);
+		}
+		if(pc->a >= 0){
+			R[pc->a] = std::move(ret);
+		}
+	}
+	VM_NEXT();
+
+	VM_CASE(enter_inline){
+		current_call_stack().set_inlined(&_inlined_frames[pc->a]);
+	}
+	VM_NEXT();
+
+	VM_CASE(leave_inline){
+		current_call_stack().set_inlined(_inlined_frames[pc->a].outer);
+	}
+	VM_NEXT();
+
+	VM_CASE(ret){
+		if(pc->d){
+			ctx.set_retval(std::move(R[pc->a]));
+		}else{
+			ctx.set_retval(variable(RK(pc->a)));
+		}
+	}
+	return nullptr;
+
+	VM_CASE(end){
+	}
+	return nullptr;
+
+#ifndef VM_THREADED_DISPATCH
+			default:
+				return nullptr;
+		}
+	}
+#endif
+}
+
+}//donkey
@@ -0,0 +1,197 @@
+#ifndef __vm_hpp__
+#define __vm_hpp__
+
+#include "runtime_context.hpp"
+#include "statements.hpp"
+#include "call_stack.hpp"
+
+#include <vector>
+#include <unordered_map>
+#include <memory>
+
+namespace donkey{
+
+class donkey_function;
+
+//operands are frame slots (>= 0) or constants (~index < 0)
+enum class vm_op: int32_t{
+	move,
+	null,
+	clear,
+	load_global,
+	store_global,
+	get_item,
+	set_item,
+
+	mul,
+	div,
+	idiv,
+	mod,
+	plus,
+	minus,
+	shiftl,
+	shiftr,
+	bitwise_and,
+	bitwise_xor,
+	bitwise_or,
+	less,
+	greater,
+	less_equal,
+	greater_equal,
+	equal,
+	unequal,
+
+	unary_plus,
+	unary_minus,
+	bitwise_not,
+	logical_not,
+
+	pre_inc,
+	pre_dec,
+	post_inc,
+	post_dec,
+
+	mul_assignment,
+	div_assignment,
+	mod_assignment,
+	plus_assignment,
+	minus_assignment,
+	shiftl_assignment,
+	shiftr_assignment,
+	and_assignment,
+	xor_assignment,
+	or_assignment,
+
+	//operands are known to be numbers
+	num_mul,
+	num_div,
+	num_mod,
+	num_plus,
+	num_minus,
+	num_less,
+	num_greater,
+	num_less_equal,
+	num_greater_equal,
+	num_equal,
+	num_unequal,
+	num_pre_inc,
+	num_pre_dec,
+	num_post_inc,
+	num_post_dec,
+	num_mul_assignment,
+	num_div_assignment,
+	num_mod_assignment,
+	num_plus_assignment,
+	num_minus_assignment,
+
+	jump,
+	jump_if,
+	jump_less,
+	jump_greater,
+	jump_less_equal,
+	jump_greater_equal,
+	jump_equal,
+	jump_unequal,
+	num_jump_less,
+	num_jump_greater,
+	num_jump_less_equal,
+	num_jump_greater_equal,
+	num_jump_equal,
+	num_jump_unequal,
+	//for loop step: a += d, then jump to label while a compares true to c
+	num_loop_less,
+	num_loop_greater,
+	num_loop_less_equal,
+	num_loop_greater_equal,
+	num_loop_unequal,
+	jump_expression,
+	switch_number,
+	switch_string,
+
+	eval,
+	exec,
+	exec_statement,
+	call,
+	call_function,
+	tail_call_function,
+	call_expression,
+	//the inlined body of call site a starts or ends; named in traces while it runs
+	enter_inline,
+	leave_inline,
+
+	ret,
+	end,
+
+	count
+};
+
+struct instruction{
+	vm_op op;
+	int32_t a;
+	int32_t b;
+	int32_t c;
+	int32_t d;
+};
+
+//function called by name, resolved when its module is loaded
+struct callee{
+	code_address address;
+	const function* native;
+	const donkey_function* code; //nullptr for native functions
+};
+
+class program{
+	friend class bytecode_builder;
+	friend class module_cache;
+	program(const program&) = delete;
+	void operator=(const program&) = delete;
+private:
+	std::vector<instruction> _code;
+	std::vector<variable> _constants;
+	std::vector<expression_ptr> _expressions;
+	std::vector<statement> _statements;
+	std::vector<number_switch> _switches;
+	std::vector<string_switch> _string_switches;
+	mutable std::vector<callee> _callees;
+	std::vector<std::string> _inlined; //one name per inlined call site
+	std::vector<int32_t> _inlined_outer; //the call site each of them is inlined into, or -1
+	std::vector<inlined_frame> _inlined_frames;
+	size_t _frame_size;
+
+	void link_inlined_frames();
+public:
+	enum{
+		max_inline_size = 12, //instructions, not counting the return
+	};
+
+	program():
+		_frame_size(0){
+	}
+
+	//returns the donkey function called in tail position, to be run by the caller
+	const donkey_function* run(runtime_context& ctx) const;
+
+	//resolves the callees once all functions of the module exist
+	void link(runtime_context& ctx) const;
+
+	size_t get_size() const{
+		return _code.size();
+	}
+
+	const std::vector<std::string>& get_inlined() const{
+		return _inlined;
+	}
+
+	//for loops whose step and condition became one instruction
+	size_t get_counted_loops() const;
+
+	//the body of a function that returns one expression, which may be lowered again in its callers:
+	//small, and free of tree nodes, which would run in the caller's frame
+	bool is_inlinable() const;
+};
+
+typedef std::shared_ptr<const program> program_ptr;
+
+}//donkey
+
+#endif /*__vm_hpp__*/
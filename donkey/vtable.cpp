@@ -1,7 +1,18 @@
 #include "vtable.hpp"
 
+#include <atomic>
+
 namespace donkey{
 
+namespace{
+
+size_t new_class_id(){
+	static std::atomic<size_t> next(0);
+	return next++;
+}
+
+}//namespace
+
 #define UPDATE_METHOD(name)\
 if(!name){\
 	auto it = _methods.find(#name);\
@@ -33,6 +44,17 @@ void vtable::update_predefined_methods(){
 
 #undef UPDATE_METHOD
 
+void vtable::update_members(){
+	_members.clear();
+	for(const auto& p: _methods){
+		_members[get_atom(p.first)] = member_info{p.second.get(), size_t(-1)};
+	}
+	for(const auto& p: _fields){
+		_members[get_atom(p.first)] = member_info{nullptr, p.second};
+	}
+	invalidate_member_caches();
+}
+
 vtable::vtable(std::string&& module_name, std::string&& name, method_ptr constructor, method_ptr destructor,
 	           std::unordered_map<std::string, method_ptr>&& methods, std::unordered_map<std::string, size_t>&& fields,
 	           size_t fields_size, bool is_public, bool is_final):
@@ -46,7 +68,10 @@ vtable::vtable(std::string&& module_name, std::string&& name, method_ptr constru
 	_fields_size(fields_size),
 	_is_public(is_public),
 	_is_final(is_final),
-	_is_native(false){
+	_is_native(false),
+	_traverser(nullptr),
+	_id(new_class_id()),
+	_data_begins(1, std::make_pair(_id, size_t(0))){
 	
 	opGet=opSet=opCall=
 	opEQ=opNE=
@@ -66,6 +91,7 @@ vtable::vtable(std::string&& module_name, std::string&& name, method_ptr constru
 	clone=strong=weak=toString=toBool = nullptr;
 	
 	update_predefined_methods();
+	update_members();
 }
 
 vtable::vtable(std::string&& module_name, std::string&& name, function creator, std::unordered_map<std::string, method_ptr>&& methods, bool is_public):
@@ -77,7 +103,10 @@ vtable::vtable(std::string&& module_name, std::string&& name, function creator,
 	_is_public(is_public),
 	_is_final(true),
 	_is_native(true),
-	_creator(creator){
+	_creator(creator),
+	_traverser(nullptr),
+	_id(new_class_id()),
+	_data_begins(1, std::make_pair(_id, size_t(0))){
 	
 	opGet=opSet=opCall=
 	opEQ=opNE=
@@ -97,6 +126,11 @@ vtable::vtable(std::string&& module_name, std::string&& name, function creator,
 	clone=strong=weak=toString=toBool = nullptr;
 	
 	update_predefined_methods();
+	update_members();
+}
+
+vtable::~vtable(){
+	invalidate_member_caches();
 }
 
 variable vtable::call_field(const variable& that, runtime_context& ctx, size_t params_size, const std::string& name) const{
@@ -153,6 +187,14 @@ void vtable::derive_from(const vtable& base){
 		_bases.insert(std::unordered_map<std::string, base_class>::value_type(p.first, base_class{p.second.vt, base_begin + p.second.data_begin}));
 	}
 	
+	//base's own entry is 0, so this covers base and all of its bases
+	for(const auto& p: base._data_begins){
+		auto it = std::lower_bound(_data_begins.begin(), _data_begins.end(), std::make_pair(p.first, size_t(0)));
+		if(it == _data_begins.end() || it->first != p.first){
+			_data_begins.insert(it, std::make_pair(p.first, base_begin + p.second));
+		}
+	}
+	
 	_fields_size += base._fields_size;
 	
 	for(const auto& p: base._methods){
@@ -177,6 +219,7 @@ void vtable::derive_from(const vtable& base){
 	}
 	
 	update_predefined_methods();
+	update_members();
 }
 
 std::vector<const vtable*> vtable::get_bases() const{
@@ -195,9 +238,9 @@ variable vtable::create(runtime_context& ctx, size_t params_size) const{
 }
 
 void vtable::call_base_constructor(const variable& that, runtime_context& ctx, size_t params_size) const{
-	if(_constructor && !ctx.is_constructed(_full_name)){
+	if(_constructor && !ctx.is_constructed(_id)){
 		(*_constructor)(that, ctx, params_size);
-		ctx.set_constructed(_full_name);
+		ctx.set_constructed(_id);
 	}
 }
 
@@ -209,14 +252,14 @@ void vtable::call_constructor(const variable& that, runtime_context& ctx, size_t
 }
 
 void vtable::call_base_destructor(const variable& that, runtime_context& ctx) const{
-	if(_destructor && !ctx.is_destroyed(_full_name)){
+	if(has_destructor() && !ctx.is_destroyed(_id)){
 		(*_destructor)(that, ctx, 0);
-		ctx.set_destroyed(_full_name);
+		ctx.set_destroyed(_id);
 	}
 }
 
 void vtable::call_destructor(const variable& that, runtime_context& ctx) const{
-	if(_destructor){
+	if(has_destructor()){
 		destructor_stack_manipulator _(ctx);
 		(*_destructor)(that, ctx, 0);
 	}
@@ -5,13 +5,26 @@
 #include "errors.hpp"
 #include "variables.hpp"
 #include "runtime_context.hpp"
+#include "atoms.hpp"
+#include "member_cache.hpp"
 
 #include <unordered_map>
+#include <algorithm>
 
 namespace donkey{
 
 class vtable;
 
+typedef std::function<void(variable&)> child_visitor;
+
+//visits every variable a native payload holds; natives without one can't be part of a cycle
+typedef void(*traverser_type)(void* payload, const child_visitor& visit);
+
+template<class T>
+void traverse_native(void* payload, const child_visitor& visit){
+	static_cast<T*>(payload)->traverse(visit);
+}
+
 struct base_class{
 	const vtable* vt;
 	size_t data_begin;
@@ -33,11 +46,17 @@ private:
 	bool _is_final;
 	bool _is_native;
 	function _creator;
+	traverser_type _traverser;
+	std::unordered_map<atom, member_info> _members;
+	size_t _id;
+	std::vector<std::pair<size_t, size_t> > _data_begins; //(class id, data begin) of this class and its bases, sorted by id
 	
 	variable call_field(const variable& that, runtime_context& ctx, size_t params_size, const std::string& name) const;
 	
 	void update_predefined_methods();
 	
+	void update_members();
+	
 	typedef method* pmethod;
 public:
 	pmethod opGet, opSet, opCall,
@@ -63,6 +82,8 @@ public:
 	
 	vtable(std::string&& module_name, std::string&& name, function creator, std::unordered_map<std::string, method_ptr>&& methods, bool is_public);
 	
+	~vtable();
+	
 	variable create(runtime_context& ctx, size_t params_size) const;
 	
 	void call_base_constructor(const variable& that, runtime_context& ctx, size_t params_size) const;
@@ -72,6 +93,10 @@ public:
 	void call_base_destructor(const variable& that, runtime_context& ctx) const;
 	
 	void call_destructor(const variable& that, runtime_context& ctx) const;
+	
+	bool has_destructor() const{
+		return _destructor && *_destructor;
+	}
 
 	variable call_member(const variable& that, runtime_context& ctx, size_t params_size, const std::string& name) const;
 	
@@ -79,30 +104,43 @@ public:
 	
 	variable& get_field(const variable& that, const std::string& name) const;
 	
-	variable call_method(const variable& that, runtime_context& ctx, size_t params_size, const std::string& type, method& m){
-		if(_full_name != type && _bases.find(type) == _bases.end()){
-			runtime_error(_full_name + " is not derived from " + type);
+	//where the fields inherited from type begin; size_t(-1) if this class isn't derived from it
+	size_t get_data_begin(const vtable& type) const{
+		auto it = std::lower_bound(_data_begins.begin(), _data_begins.end(), std::make_pair(type._id, size_t(0)));
+		return it != _data_begins.end() && it->first == type._id ? it->second : size_t(-1);
+	}
+	
+	bool is_derived_from(const vtable& type) const{
+		return get_data_begin(type) != size_t(-1);
+	}
+	
+	variable call_method(const variable& that, runtime_context& ctx, size_t params_size, const vtable& type, method& m) const{
+		if(!is_derived_from(type)){
+			runtime_error(_full_name + " is not derived from " + type._full_name);
 		}
 		
 		return m(that, ctx, params_size);
 	}
 	
-	variable& get_field(const variable& that, const std::string& type, size_t idx){
-		if(type == _full_name){
-			return that.nth_field(idx);
-		}
-		auto it = _bases.find(type);
-		if(it == _bases.end()){
-			runtime_error(_full_name + " is not derived from " + type);
+	variable& get_field(const variable& that, const vtable& type, size_t idx) const{
+		size_t data_begin = get_data_begin(type);
+		if(data_begin == size_t(-1)){
+			runtime_error(_full_name + " is not derived from " + type._full_name);
 		}
 		
-		return that.nth_field(it->second.data_begin + idx);
+		return that.nth_field(data_begin + idx);
 	}
 	
 	bool has_member(const std::string& name) const{
 		return has_method(name) || has_field(name);
 	}
 	
+	//nullptr if there is no such member
+	const member_info* find_member(atom name) const{
+		auto it = _members.find(name);
+		return it == _members.end() ? nullptr : &it->second;
+	}
+	
 	bool has_method(const std::string& name) const{
 		return _methods.find(name) != _methods.end();
 	}
@@ -150,6 +188,19 @@ public:
 	bool is_native() const{
 		return _is_native;
 	}
+	
+	//dense, unique for the lifetime of the process
+	size_t get_id() const{
+		return _id;
+	}
+	
+	void set_traverser(traverser_type traverser){
+		_traverser = traverser;
+	}
+	
+	traverser_type get_traverser() const{
+		return _traverser;
+	}
 };
 
 typedef std::shared_ptr<vtable> vtable_ptr;
@@ -32,6 +32,8 @@ SOURCES += \
     ../donkey/compilers/statement_compiler.cpp \
     ../donkey/compilers/using_compiler.cpp \
     ../donkey/compilers/variable_compiler.cpp \
+    ../donkey/compilers/bytecode_compiler.cpp \
+    ../donkey/compilers/lazy_function.cpp \
     ../donkey/modules/io/io_module.cpp \
     ../donkey/string_vtable.cpp \
     ../donkey/array_vtable.cpp \
@@ -40,6 +42,15 @@ SOURCES += \
     ../donkey/expressions/operators.cpp \
     ../donkey/vtable.cpp \
     ../donkey/errors.cpp \
+    ../donkey/vm.cpp \
+    ../donkey/allocator.cpp \
+    ../donkey/collector.cpp \
+    ../donkey/atoms.cpp \
+    ../donkey/arena.cpp \
+    ../donkey/member_cache.cpp \
+    ../donkey/call_stack.cpp \
+    ../donkey/switch_tables.cpp \
+    ../donkey/module_cache.cpp \
     ../donkey/modules/gui/gui_module.cpp \
     ../donkey/modules/gui/window_X11.cpp \
     ../donkey/modules/functional/functional_module.cpp
@@ -68,6 +79,15 @@ HEADERS += \
     ../donkey/compiler_helpers.hpp \
     ../donkey/module_bundle.hpp \
     ../donkey/donkey_function.hpp \
+    ../donkey/vm.hpp \
+    ../donkey/allocator.hpp \
+    ../donkey/collector.hpp \
+    ../donkey/atoms.hpp \
+    ../donkey/arena.hpp \
+    ../donkey/member_cache.hpp \
+    ../donkey/call_stack.hpp \
+    ../donkey/switch_tables.hpp \
+    ../donkey/module_cache.hpp \
     ../donkey/expressions/arithmetic_expressions.hpp \
     ../donkey/compilers/branch_compilers.hpp \
     ../donkey/compilers/class_compiler.hpp \
@@ -79,6 +99,8 @@ HEADERS += \
     ../donkey/compilers/statement_compiler.hpp \
     ../donkey/compilers/using_compiler.hpp \
     ../donkey/compilers/variable_compiler.hpp \
+    ../donkey/compilers/bytecode_compiler.hpp \
+    ../donkey/compilers/lazy_function.hpp \
     ../donkey/expressions/assignment_expressions.hpp \
     ../donkey/expressions/core_expressions.hpp \
     ../donkey/expressions/functional_expressions.hpp \